@@ -0,0 +1,119 @@
+#include "Arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+// Заголовок перед каждым узлом: откуда взята память и жив ли ещё объект.
+// 16 байт сохраняют выравнивание long double у следующего за ним узла.
+struct NodeHeader {
+    ExpressionArena *arena;
+    uint32_t size;
+    uint32_t live;
+};
+static_assert(sizeof(NodeHeader) == 16);
+
+static thread_local ExpressionArena *current_arena = nullptr;
+
+static size_t block_size(size_t size) {
+    return sizeof(NodeHeader) + ((size + 15) & ~size_t(15));
+}
+
+ExpressionArena::Scope::Scope(ExpressionArena &arena) : previous(current_arena) {
+    current_arena = &arena;
+}
+ExpressionArena::Scope::~Scope() {
+    current_arena = previous;
+}
+
+ExpressionArena::ExpressionArena(size_t size) : chunk_size(size) {}
+ExpressionArena::~ExpressionArena() {
+    clear();
+}
+
+void* ExpressionArena::allocate(size_t size) {
+    size_t need = block_size(size);
+    if (chunks.empty() || chunks.back().used + need > chunk_size) {
+        size_t capacity = std::max(chunk_size, need);
+        chunks.push_back({static_cast<char *>(::operator new(capacity)), 0});
+    }
+    Chunk &chunk = chunks.back();
+    NodeHeader *header = reinterpret_cast<NodeHeader *>(chunk.data + chunk.used);
+    chunk.used += need;
+    *header = {this, uint32_t(size), 1};
+    ++node_count;
+    return header + 1;
+}
+
+void* ExpressionArena::allocate_node(size_t size) {
+    if (current_arena)
+        return current_arena->allocate(size);
+    NodeHeader *header = static_cast<NodeHeader *>(::operator new(sizeof(NodeHeader) + size));
+    *header = {nullptr, uint32_t(size), 1};
+    return header + 1;
+}
+void ExpressionArena::free_node(void *p) {
+    if (!p) return;
+    NodeHeader *header = static_cast<NodeHeader *>(p) - 1;
+    if (header->arena)
+        header->live = 0;
+    else
+        ::operator delete(header);
+}
+
+// Все ли узлы дерева взяты из арены arena
+static bool owned(const Expression &root, const ExpressionArena *arena) {
+    std::vector<const Expression *> stack = {&root};
+    while (!stack.empty()) {
+        const Expression *node = stack.back();
+        stack.pop_back();
+        if ((reinterpret_cast<const NodeHeader *>(node) - 1)->arena != arena) return false;
+        for (int i = 0; i < 2; ++i)
+            if (const Expression *operand = node->operand(i)) stack.push_back(operand);
+    }
+    return true;
+}
+
+// Дерево с узлами из кучи или чужой арены копируется в эту арену, а исходное удаляется обычным
+// образом: отпущенные узлы не из арены не освободил бы никто
+Expression* ExpressionArena::adopt(std::unique_ptr<Expression> expr) {
+    if (!expr || owned(*expr, this)) return expr.release();
+    Scope scope(*this);
+    return expr->clone().release();
+}
+
+// Каждый живой узел разрушается по отдельности: сначала у него забираются операнды,
+// поэтому деструкторы не вызывают друг друга рекурсивно. Операнды из кучи или чужой арены
+// удаляются обычным образом.
+void ExpressionArena::clear() {
+    std::vector<std::unique_ptr<Expression>> operands;
+    for (Chunk &chunk : chunks) {
+        for (size_t offset = 0; offset < chunk.used;) {
+            NodeHeader *header = reinterpret_cast<NodeHeader *>(chunk.data + offset);
+            offset += block_size(header->size);
+            if (!header->live) continue;
+            header->live = 0;
+            Expression *node = reinterpret_cast<Expression *>(header + 1);
+            node->detach(operands);
+            for (std::unique_ptr<Expression> &operand : operands) {
+                if (operand && (reinterpret_cast<NodeHeader *>(operand.get()) - 1)->arena == this)
+                    operand.release();
+            }
+            operands.clear();
+            node->~Expression();
+        }
+    }
+    for (Chunk &chunk : chunks)
+        ::operator delete(chunk.data);
+    chunks.clear();
+    node_count = 0;
+}
+
+size_t ExpressionArena::nodes() const {
+    return node_count;
+}
+size_t ExpressionArena::bytes() const {
+    size_t result = 0;
+    for (const Chunk &chunk : chunks) result += chunk.used;
+    return result;
+}
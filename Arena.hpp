@@ -0,0 +1,54 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include "Expression.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Арена узлов выражений: память выделяется сдвигом указателя внутри больших блоков
+// и освобождается разом вместе с ареной.
+// Пока жив ExpressionArena::Scope, все узлы, созданные в этом потоке (в том числе через
+// clone, differentiate и simplify), попадают в арену. delete узла из арены ничего не освобождает.
+// Арена должна пережить все unique_ptr на свои узлы; деревья, которые не нужно разрушать
+// по отдельности, передаются арене через adopt() и уничтожаются ею без рекурсии; дерево, в котором
+// есть узлы не из этой арены, adopt() сначала копирует в неё.
+class ExpressionArena {
+public:
+    class Scope {
+        ExpressionArena *previous;
+    public:
+        explicit Scope(ExpressionArena &);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope& operator=(const Scope &) = delete;
+    };
+
+    explicit ExpressionArena(size_t chunk_size = 64 * 1024);
+    ~ExpressionArena();
+    ExpressionArena(const ExpressionArena &) = delete;
+    ExpressionArena& operator=(const ExpressionArena &) = delete;
+
+    Expression* adopt(std::unique_ptr<Expression>);
+    // разрушает все ещё живые узлы и возвращает блоки памяти
+    void clear();
+
+    size_t nodes() const;
+    size_t bytes() const;
+
+    static void* allocate_node(size_t);
+    static void free_node(void *);
+
+private:
+    struct Chunk {
+        char *data;
+        size_t used;
+    };
+    std::vector<Chunk> chunks;
+    size_t chunk_size;
+    size_t node_count = 0;
+
+    void* allocate(size_t);
+};
+
+#endif
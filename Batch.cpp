@@ -0,0 +1,102 @@
+#include "Batch.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+std::vector<int32_t> allocate_registers(const Program &program, size_t &count) {
+    const std::vector<Instruction> &code = program.code;
+    std::vector<size_t> last_use(code.size(), code.size());
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (arity(code[i].op) >= 1) last_use[code[i].a] = i;
+        if (arity(code[i].op) == 2) last_use[code[i].b] = i;
+    }
+    std::vector<int32_t> reg(code.size(), -1);
+    std::vector<int32_t> free;
+    count = 0;
+    for (size_t i = 0; i < code.size(); ++i) {
+        const Instruction &ins = code[i];
+        if (ins.op == 'v') continue;
+        // операнды, прочитанные в последний раз, освобождаются до выделения результата:
+        // ядра поэлементные, поэтому запись на место операнда безопасна
+        if (arity(ins.op) >= 1 && reg[ins.a] >= 0 && last_use[ins.a] == i)
+            free.push_back(reg[ins.a]);
+        if (arity(ins.op) == 2 && ins.b != ins.a && reg[ins.b] >= 0 && last_use[ins.b] == i)
+            free.push_back(reg[ins.b]);
+        if (free.empty()) {
+            reg[i] = count++;
+        } else {
+            reg[i] = free.back();
+            free.pop_back();
+        }
+    }
+    return reg;
+}
+
+// Значения инструкций, не зависящих от переменных (NaN — зависит): так распознаётся и показатель
+// неупрощённого дерева, например x ^ (0 - 3) после разбора x ^ -3
+static std::vector<T> constant_values(const Program &program) {
+    const std::vector<Instruction> &code = program.code;
+    std::vector<T> values(code.size(), NAN);
+    for (size_t i = 0; i < code.size(); ++i) {
+        const Instruction &ins = code[i];
+        switch (arity(ins.op)) {
+            case 0:
+                if (ins.op == 'n') values[i] = program.constants[ins.a];
+                break;
+            case 1: values[i] = apply_unary(ins.op, values[ins.a]); break;
+            default: values[i] = apply_binary(ins.op, values[ins.a], values[ins.b]);
+        }
+    }
+    return values;
+}
+
+// Показатель степени, если инструкция — x ^ n с постоянным целым n, которую можно считать умножениями,
+// иначе 0 (x ^ 0 остаётся pow: это константа 1 ещё при упрощении)
+static int power_exponent(const std::vector<T> &constants, const Instruction &ins, MathMode mode) {
+    if (ins.op != '^') return 0;
+    T value = constants[ins.b];
+    if (value != std::floor(value) || std::fabs(value) > 64 || !power_by_multiplication(int(value), mode)) return 0;
+    return int(value);
+}
+
+template <typename N>
+void evaluate_batch(const Program &program, const N *const *columns, size_t rows, N *out, MathMode mode) {
+    const std::vector<Instruction> &code = program.code;
+    size_t count = 0;
+    std::vector<int32_t> reg = allocate_registers(program, count);
+    std::vector<int> powers(code.size());
+    if constexpr (std::is_same_v<N, double>) {
+        std::vector<T> constants = constant_values(program);
+        for (size_t i = 0; i < code.size(); ++i)
+            powers[i] = power_exponent(constants, code[i], mode);
+    }
+    std::vector<N> registers(count * BATCH_BLOCK);
+    for (size_t start = 0; start < rows; start += BATCH_BLOCK) {
+        size_t n = std::min(BATCH_BLOCK, rows - start);
+        auto place = [&](uint32_t k) -> const N * {
+            return reg[k] < 0 ? columns[code[k].a] + start : registers.data() + reg[k] * BATCH_BLOCK;
+        };
+        for (size_t i = 0; i < code.size(); ++i) {
+            const Instruction &ins = code[i];
+            if (ins.op == 'v') continue;
+            N *dst = registers.data() + reg[i] * BATCH_BLOCK;
+            switch (arity(ins.op)) {
+                case 0: std::fill(dst, dst + n, N(program.constants[ins.a])); break;
+                case 1: kernel_unary(ins.op, place(ins.a), dst, n, mode); break;
+                default:
+                    if constexpr (std::is_same_v<N, double>) {
+                        if (powers[i]) {
+                            kernel_power(place(ins.a), powers[i], dst, n);
+                            break;
+                        }
+                    }
+                    kernel_binary(ins.op, place(ins.a), place(ins.b), dst, n, mode);
+            }
+        }
+        const N *result = place(code.size() - 1);
+        std::copy(result, result + n, out + start);
+    }
+}
+
+template void evaluate_batch<double>(const Program &, const double *const *, size_t, double *, MathMode);
+template void evaluate_batch<long double>(const Program &, const long double *const *, size_t, long double *, MathMode);
@@ -0,0 +1,23 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include "Bytecode.hpp"
+#include "Kernels.hpp"
+
+// Строки обрабатываются блоками по BATCH_BLOCK, внутри блока каждая инструкция — один поэлементный цикл
+constexpr size_t BATCH_BLOCK = 256;
+
+// Вычисление программы сразу для rows строк.
+// columns[slot] — непрерывный массив значений переменной program.variables[slot], out — rows результатов.
+// Реализовано для double (векторные ядра, точность — по mode) и long double.
+// Для double x ^ n с целым n, не зависящим от переменных (и в неупрощённом дереве: x ^ -3 разбирается
+// как x ^ (0 - 3)), считается умножениями, если это позволяет power_by_multiplication;
+// long double совпадает с построчным вычислением бит в бит.
+template <typename N>
+void evaluate_batch(const Program &, const N *const *columns, size_t rows, N *out, MathMode mode = MathMode::ACCURATE);
+
+// Номер физического регистра блока для каждой инструкции (-1 — читается прямо из столбца).
+// Регистры переиспользуются после последнего чтения, так что их обычно немного.
+std::vector<int32_t> allocate_registers(const Program &, size_t &count);
+
+#endif
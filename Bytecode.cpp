@@ -0,0 +1,69 @@
+#include "Bytecode.hpp"
+#include "Stats.hpp"
+
+#include <unordered_map>
+
+size_t Program::size() const {
+    return code.size();
+}
+size_t Program::slot(std::string_view name) const {
+    for (size_t i = 0; i < variables.size(); ++i)
+        if (variables[i] == name) return i;
+    return -1;
+}
+
+T Program::evaluate(const T *slots) const {
+    // буфер регистров свой у каждого потока и переиспользуется между вызовами
+    thread_local std::vector<T> registers;
+    if (registers.size() < code.size())
+        registers.resize(code.size());
+    return run(slots, registers.data());
+}
+T Program::evaluate(const std::map<std::string, T> &x) const {
+    std::vector<T> slots(variables.size());
+    for (size_t i = 0; i < variables.size(); ++i) {
+        auto it = x.find(variables[i]);
+        slots[i] = (it != x.end()) ? it->second : T{};
+    }
+    return evaluate(slots.data());
+}
+
+// Обход в обратной польской записи с явным стеком, чтобы не упираться в глубину рекурсии
+Program compile(const Expression &root) {
+    STATS(PhaseTimer timer(COMPILE);)
+    Program program;
+    std::unordered_map<std::string, uint32_t> slots;
+    std::vector<std::pair<const Expression *, bool>> stack = {{&root, false}};
+    std::vector<uint32_t> results;
+    while (!stack.empty()) {
+        auto [node, visited] = stack.back();
+        stack.pop_back();
+        char op = node->operation();
+        Instruction ins = {op, 0, 0};
+        if (op == 'n') {
+            ins.a = program.constants.size();
+            program.constants.push_back(static_cast<const Constant *>(node)->get_value());
+        } else if (op == 'v') {
+            const std::string &name = static_cast<const Variable *>(node)->get_name();
+            auto [it, inserted] = slots.try_emplace(name, program.variables.size());
+            if (inserted) program.variables.push_back(name);
+            ins.a = it->second;
+        } else if (!visited) {
+            stack.push_back({node, true});
+            if (node->operand(1)) stack.push_back({node->operand(1), false});
+            stack.push_back({node->operand(0), false});
+            continue;
+        } else if (node->operand(1)) {
+            ins.b = results.back();
+            results.pop_back();
+            ins.a = results.back();
+            results.pop_back();
+        } else {
+            ins.a = results.back();
+            results.pop_back();
+        }
+        results.push_back(program.code.size());
+        program.code.push_back(ins);
+    }
+    return program;
+}
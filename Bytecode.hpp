@@ -0,0 +1,70 @@
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+#include "Expression.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Инструкция i пишет результат в регистр i.
+// op: 'n' — константа constants[a], 'v' — переменная из слота a,
+// 's' 'c' 'l' 'e' — унарная операция над регистром a, + - * / ^ — над регистрами a и b
+struct Instruction {
+    char op;
+    uint32_t a, b;
+};
+
+// число регистров-операндов у инструкции с кодом op
+inline int arity(char op) {
+    switch (op) {
+        case 'n': case 'v': return 0;
+        case 's': case 'c': case 'l': case 'e': return 1;
+        default: return 2;
+    }
+}
+
+// Плоская постфиксная программа, в которую компилируется дерево выражения.
+// Переменные один раз отображаются в номера слотов: variables[slot] — имя переменной.
+class Program {
+public:
+    std::vector<Instruction> code;
+    std::vector<T> constants;
+    std::vector<std::string> variables;
+
+    size_t size() const;
+    // номер слота переменной или -1, если её нет в выражении
+    size_t slot(std::string_view) const;
+
+    T evaluate(const T *slots) const;
+    T evaluate(const std::map<std::string, T> & = {}) const;
+
+    // Прогон по произвольному числовому типу; registers должен вмещать size() значений
+    template <typename N>
+    N run(const N *slots, N *registers) const;
+};
+
+// Прогон плоского кода, где бы он ни лежал (в Program или в отображённом в память файле)
+template <typename N>
+N run(const Instruction *code, size_t size, const T *constants, const N *slots, N *registers) {
+    for (size_t i = 0; i < size; ++i) {
+        const Instruction &ins = code[i];
+        switch (ins.op) {
+            case 'n': registers[i] = N(constants[ins.a]); break;
+            case 'v': registers[i] = slots[ins.a]; break;
+            case 's': case 'c': case 'l': case 'e':
+                registers[i] = apply_unary(ins.op, registers[ins.a]); break;
+            default:
+                registers[i] = apply_binary(ins.op, registers[ins.a], registers[ins.b]);
+        }
+    }
+    return registers[size - 1];
+}
+
+template <typename N>
+N Program::run(const N *slots, N *registers) const {
+    return ::run(code.data(), code.size(), constants.data(), slots, registers);
+}
+
+Program compile(const Expression &);
+
+#endif
@@ -0,0 +1,318 @@
+#include "Dag.hpp"
+
+#include <cmath>
+#include <functional>
+
+// Константы сравниваются по представлению, а не по ==: все NaN — одна константа, а 0 и -0 — разные
+// (1 / -0 = -inf). Байты long double целиком не сравниваются: в них есть незначащие байты выравнивания
+static bool same_value(T x, T y) {
+    if (std::isnan(x) || std::isnan(y)) return std::isnan(x) && std::isnan(y);
+    return x == y && std::signbit(x) == std::signbit(y);
+}
+bool Node::operator==(const Node &other) const {
+    return op == other.op && a == other.a && b == other.b && same_value(value, other.value);
+}
+size_t NodeHash::operator()(const Node &node) const {
+    size_t h = std::isnan(node.value) ? 1 : std::hash<T>()(node.value) * 2 + std::signbit(node.value);
+    h = h * 1000003 + (size_t)node.op;
+    h = h * 1000003 + node.a;
+    h = h * 1000003 + node.b;
+    return h;
+}
+
+
+//-------------//
+//---BUILDING--//
+//-------------//
+NodeStore::Id NodeStore::intern(const Node &node) {
+    auto [it, inserted] = index.try_emplace(node, nodes.size());
+    if (inserted) nodes.push_back(node);
+    return it->second;
+}
+NodeStore::Id NodeStore::constant(T value) {
+    Node node = {'n'};
+    node.value = value;
+    return intern(node);
+}
+NodeStore::Id NodeStore::variable(const std::string &x) {
+    auto [it, inserted] = name_index.try_emplace(x, names.size());
+    if (inserted) names.push_back(x);
+    return intern({'v', it->second});
+}
+NodeStore::Id NodeStore::unary(char op, Id a) {
+    return intern({op, a});
+}
+NodeStore::Id NodeStore::binary(char op, Id a, Id b) {
+    return intern({op, a, b});
+}
+
+const Node& NodeStore::operator[](Id id) const {
+    return nodes[id];
+}
+size_t NodeStore::size() const {
+    return nodes.size();
+}
+const std::string& NodeStore::name(Id id) const {
+    return names[nodes[id].a];
+}
+bool NodeStore::is_value(Id id, T value) const {
+    return nodes[id].op == 'n' && nodes[id].value == value;
+}
+
+NodeStore::Id NodeStore::insert(const Expression &root) {
+    std::vector<std::pair<const Expression *, bool>> stack = {{&root, false}};
+    std::vector<Id> results;
+    while (!stack.empty()) {
+        auto [node, visited] = stack.back();
+        stack.pop_back();
+        char op = node->operation();
+        if (op == 'n') {
+            results.push_back(constant(static_cast<const Constant *>(node)->get_value()));
+        } else if (op == 'v') {
+            results.push_back(variable(static_cast<const Variable *>(node)->get_name()));
+        } else if (!visited) {
+            stack.push_back({node, true});
+            if (node->operand(1)) stack.push_back({node->operand(1), false});
+            stack.push_back({node->operand(0), false});
+        } else if (node->operand(1)) {
+            Id b = results.back();
+            results.pop_back();
+            results.back() = binary(op, results.back(), b);
+        } else {
+            results.back() = unary(op, results.back());
+        }
+    }
+    return results.back();
+}
+
+NodeStore::Id NodeStore::import(const NodeStore &other, Id root, std::unordered_map<Id, Id> &copied) {
+    std::vector<std::pair<Id, bool>> stack = {{root, false}};
+    while (!stack.empty()) {
+        auto [id, visited] = stack.back();
+        stack.pop_back();
+        if (copied.count(id)) continue;
+        const Node &node = other.nodes[id];
+        int n = arity(node.op);
+        if (!visited && n > 0) {
+            stack.push_back({id, true});
+            if (n == 2) stack.push_back({node.b, false});
+            stack.push_back({node.a, false});
+            continue;
+        }
+        Id result;
+        if (node.op == 'n') result = constant(node.value);
+        else if (node.op == 'v') result = variable(other.names[node.a]);
+        else if (n == 1) result = unary(node.op, copied[node.a]);
+        else result = binary(node.op, copied[node.a], copied[node.b]);
+        copied[id] = result;
+    }
+    return copied[root];
+}
+
+// Общие узлы разворачиваются в отдельные копии: дерево не умеет разделять поддеревья
+std::unique_ptr<Expression> NodeStore::extract(Id root) const {
+    std::vector<std::pair<Id, bool>> stack = {{root, false}};
+    std::vector<std::unique_ptr<Expression>> results;
+    while (!stack.empty()) {
+        auto [id, visited] = stack.back();
+        stack.pop_back();
+        const Node &node = nodes[id];
+        if (node.op == 'n') {
+            results.push_back(std::make_unique<Constant>(node.value));
+        } else if (node.op == 'v') {
+            results.push_back(std::make_unique<Variable>(names[node.a]));
+        } else if (!visited) {
+            stack.push_back({id, true});
+            if (arity(node.op) == 2) stack.push_back({node.b, false});
+            stack.push_back({node.a, false});
+        } else if (arity(node.op) == 2) {
+            std::unique_ptr<Expression> r = std::move(results.back());
+            results.pop_back();
+            results.back() = std::make_unique<Binary>(node.op, std::move(results.back()), std::move(r));
+        } else {
+            results.back() = std::make_unique<Unary>(node.op, std::move(results.back()));
+        }
+    }
+    return std::move(results.back());
+}
+
+
+//---------------------//
+//---DIFFERENTIATION---//
+//---------------------//
+// Те же правила, что и у Binary/Unary::differentiate, но каждый узел дифференцируется один раз.
+// Явный стек: узел обрабатывается, когда производные его операндов уже запомнены;
+// x ^ y дифференцируется как exp(y * ln(x)), поэтому операндом считается этот узел.
+NodeStore::Id NodeStore::differentiate(Id root, const std::string &x) {
+    auto [name_it, inserted] = name_index.try_emplace(x, names.size());
+    if (inserted) names.push_back(x);
+    uint32_t var = name_it->second;
+    auto key = [var](Id id) { return (uint64_t(id) << 32) | var; };
+    auto power = [this](const Node &node) { return unary('e', binary('*', node.b, unary('l', node.a))); };
+
+    std::vector<std::pair<Id, bool>> stack = {{root, false}};
+    while (!stack.empty()) {
+        auto [id, ready] = stack.back();
+        stack.pop_back();
+        if (derivatives.count(key(id))) continue;
+        Node node = nodes[id];
+        if (!ready) {
+            stack.push_back({id, true});
+            if (node.op == '^') {
+                stack.push_back({power(node), false});
+            } else {
+                if (arity(node.op) == 2) stack.push_back({node.b, false});
+                if (arity(node.op) >= 1) stack.push_back({node.a, false});
+            }
+            continue;
+        }
+        auto d = [&](Id operand) { return derivatives.at(key(operand)); };
+        Id result;
+        switch (node.op) {
+            case 'n': result = constant(0); break;
+            case 'v': result = constant(names[node.a] == x ? 1 : 0); break;
+            case 's': result = binary('*', unary('c', node.a), d(node.a)); break;
+            case 'c': result = binary('*', binary('-', constant(0), unary('s', node.a)), d(node.a)); break;
+            case 'l': result = binary('/', d(node.a), node.a); break;
+            case 'e': result = binary('*', id, d(node.a)); break;
+            case '+': case '-':
+                result = binary(node.op, d(node.a), d(node.b));
+                break;
+            case '*':
+                result = binary('+', binary('*', d(node.a), node.b), binary('*', node.a, d(node.b)));
+                break;
+            case '/':
+                result = binary('/',
+                    binary('-', binary('*', d(node.a), node.b), binary('*', node.a, d(node.b))),
+                    binary('^', node.b, constant(2)));
+                break;
+            case '^': result = d(power(node)); break;
+            default: throw std::runtime_error(std::string("Unknown operator: ") + node.op);
+        }
+        derivatives[key(id)] = result;
+    }
+    return derivatives.at(key(root));
+}
+
+
+//--------------------//
+//---SIMPLIFICATION---//
+//--------------------//
+// Те же тождества с 0 и 1, что и у Binary::simplify, плюс свёртка константных подвыражений
+NodeStore::Id NodeStore::simplify(Id root) {
+    std::vector<std::pair<Id, bool>> stack = {{root, false}};
+    while (!stack.empty()) {
+        auto [id, ready] = stack.back();
+        stack.pop_back();
+        if (simplified.count(id)) continue;
+        Node node = nodes[id];
+        if (!ready && arity(node.op) > 0) {
+            stack.push_back({id, true});
+            if (arity(node.op) == 2) stack.push_back({node.b, false});
+            stack.push_back({node.a, false});
+            continue;
+        }
+        Id result = id;
+        if (arity(node.op) == 1) {
+            Id e = simplified.at(node.a);
+            if (nodes[e].op == 'n') result = constant(apply_unary(node.op, nodes[e].value));
+            else result = unary(node.op, e);
+        } else if (arity(node.op) == 2) {
+            Id l = simplified.at(node.a), r = simplified.at(node.b);
+            result = binary(node.op, l, r);
+            if (nodes[l].op == 'n' && nodes[r].op == 'n') {
+                result = constant(apply_binary(node.op, nodes[l].value, nodes[r].value));
+            } else {
+                switch (node.op) {
+                    case '+':
+                        if (is_value(l, 0)) result = r;
+                        else if (is_value(r, 0)) result = l;
+                        break;
+                    case '-':
+                        if (is_value(r, 0)) result = l;
+                        break;
+                    case '*':
+                        if (is_value(l, 0) || is_value(r, 0)) result = constant(0);
+                        else if (is_value(l, 1)) result = r;
+                        else if (is_value(r, 1)) result = l;
+                        break;
+                    case '/':
+                        if (is_value(l, 0)) result = constant(0);
+                        else if (is_value(r, 1)) result = l;
+                        break;
+                    case '^':
+                        if (is_value(l, 0)) result = constant(0);
+                        else if (is_value(l, 1) || is_value(r, 0)) result = constant(1);
+                        else if (is_value(r, 1)) result = l;
+                        break;
+                }
+            }
+        }
+        simplified[id] = result;
+        simplified[result] = result;
+    }
+    return simplified.at(root);
+}
+
+
+//----------------//
+//---EVALUATION---//
+//----------------//
+Program NodeStore::compile(Id root) const {
+    std::vector<uint32_t> outputs;
+    return compile({root}, outputs);
+}
+Program NodeStore::compile(const std::vector<Id> &roots, std::vector<uint32_t> &outputs) const {
+    Program program;
+    std::unordered_map<Id, uint32_t> registers;
+    std::unordered_map<uint32_t, uint32_t> slots;
+    for (Id root : roots) {
+        std::vector<std::pair<Id, bool>> stack = {{root, false}};
+        while (!stack.empty()) {
+            auto [id, visited] = stack.back();
+            stack.pop_back();
+            if (registers.count(id)) continue;
+            const Node &node = nodes[id];
+            Instruction ins = {node.op, 0, 0};
+            if (node.op == 'n') {
+                ins.a = program.constants.size();
+                program.constants.push_back(node.value);
+            } else if (node.op == 'v') {
+                auto [it, inserted] = slots.try_emplace(node.a, program.variables.size());
+                if (inserted) program.variables.push_back(names[node.a]);
+                ins.a = it->second;
+            } else if (!visited) {
+                stack.push_back({id, true});
+                if (arity(node.op) == 2) stack.push_back({node.b, false});
+                stack.push_back({node.a, false});
+                continue;
+            } else {
+                ins.a = registers[node.a];
+                if (arity(node.op) == 2) ins.b = registers[node.b];
+            }
+            registers[id] = program.code.size();
+            program.code.push_back(ins);
+        }
+        outputs.push_back(registers[root]);
+    }
+    return program;
+}
+T NodeStore::evaluate(Id id, const std::map<std::string, T> &x) const {
+    return compile(id).evaluate(x);
+}
+
+size_t NodeStore::count(Id root) const {
+    std::vector<bool> seen(nodes.size());
+    std::vector<Id> stack = {root};
+    size_t result = 0;
+    while (!stack.empty()) {
+        Id id = stack.back();
+        stack.pop_back();
+        if (seen[id]) continue;
+        seen[id] = true;
+        ++result;
+        if (arity(nodes[id].op) >= 1) stack.push_back(nodes[id].a);
+        if (arity(nodes[id].op) == 2) stack.push_back(nodes[id].b);
+    }
+    return result;
+}
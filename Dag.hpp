@@ -0,0 +1,66 @@
+#ifndef DAG_HPP
+#define DAG_HPP
+
+#include "Bytecode.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+// Узел хранилища: op как у дерева ('n' — константа value, 'v' — переменная names[a],
+// 's' 'c' 'l' 'e' — унарная операция над a, + - * / ^ — над a и b)
+struct Node {
+    char op;
+    uint32_t a = 0, b = 0;
+    T value = 0;
+
+    bool operator==(const Node &) const;
+};
+
+struct NodeHash {
+    size_t operator()(const Node &) const;
+};
+
+// Хранилище с хеш-консингом: структурно одинаковые подвыражения существуют в одном экземпляре,
+// так что выражение — это DAG, а не дерево. Производные и упрощения запоминаются для каждого узла,
+// поэтому общие поддеревья дифференцируются, упрощаются и вычисляются один раз.
+class NodeStore {
+public:
+    using Id = uint32_t;
+
+    Id constant(T);
+    Id variable(const std::string &);
+    Id unary(char, Id);
+    Id binary(char, Id, Id);
+
+    Id insert(const Expression &);
+    // подграф id другого хранилища; copied — уже перенесённые узлы (общая для серии вызовов)
+    Id import(const NodeStore &, Id, std::unordered_map<Id, Id> &copied);
+    std::unique_ptr<Expression> extract(Id) const;
+
+    Id differentiate(Id, const std::string &);
+    Id simplify(Id);
+    T evaluate(Id, const std::map<std::string, T> & = {}) const;
+    // программа, в которой каждый общий узел вычисляется один раз
+    Program compile(Id) const;
+    // одна программа на несколько корней; outputs[k] — регистр со значением roots[k]
+    Program compile(const std::vector<Id> &roots, std::vector<uint32_t> &outputs) const;
+
+    const Node &operator[](Id) const;
+    size_t size() const;
+    // число различных узлов, достижимых из id
+    size_t count(Id) const;
+    const std::string &name(Id) const;
+
+private:
+    std::vector<Node> nodes;
+    std::unordered_map<Node, Id, NodeHash> index;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> name_index;
+    std::unordered_map<uint64_t, Id> derivatives;
+    std::unordered_map<Id, Id> simplified;
+
+    Id intern(const Node &);
+    bool is_value(Id, T) const;
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include "Executor.hpp"
+#include "Batch.hpp"
+
+#include <algorithm>
+#include <utility>
+
+Executor::Executor(size_t threads) {
+    threads = std::max<size_t>(threads, 1);
+    for (size_t i = 0; i < threads; ++i)
+        queues.push_back(std::make_unique<Queue>());
+    for (size_t i = 1; i < threads; ++i)
+        workers.emplace_back(&Executor::loop, this, i);
+}
+Executor::~Executor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+size_t Executor::size() const {
+    return queues.size();
+}
+
+// Своя очередь — с конца (недавние куски ещё в кэше), чужая — с начала
+bool Executor::pop(size_t self, std::pair<size_t, size_t> &range) {
+    for (size_t k = 0; k < queues.size(); ++k) {
+        Queue &queue = *queues[(self + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.ranges.empty()) continue;
+        if (k == 0) {
+            range = queue.ranges.back();
+            queue.ranges.pop_back();
+        } else {
+            range = queue.ranges.front();
+            queue.ranges.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+// Исключение куска запоминается (первое из всех), а оставшиеся куски снимаются с очередей без
+// выполнения: parallel_for дожидается remaining == 0 и бросает его в вызывающем потоке
+void Executor::work(size_t self) {
+    std::pair<size_t, size_t> range;
+    while (pop(self, range)) {
+        if (!failed) {
+            try {
+                (*job)(self, range.first, range.second);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) error = std::current_exception();
+                failed = true;
+            }
+        }
+        if (--remaining == 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.notify_all();
+        }
+    }
+}
+void Executor::loop(size_t self) {
+    size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stop || generation != seen; });
+            if (stop) return;
+            seen = generation;
+        }
+        work(self);
+    }
+}
+
+void Executor::parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t, size_t)> &f) {
+    if (count == 0) return;
+    std::lock_guard<std::mutex> serial(call);
+    grain = std::max<size_t>(grain, 1);
+    size_t chunks = (count + grain - 1) / grain;
+    job = &f;
+    failed = false;
+    remaining = chunks;
+    for (size_t i = 0; i < chunks; ++i) {
+        Queue &queue = *queues[i * queues.size() / chunks];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.ranges.push_back({i * grain, std::min(count, (i + 1) * grain)});
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++generation;
+    }
+    wake.notify_all();
+    work(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&]() { return remaining == 0; });
+    job = nullptr;
+    if (error) std::rethrow_exception(std::exchange(error, nullptr));
+}
+
+template <typename N>
+void evaluate_parallel(const Program &program, const N *const *columns, size_t rows, N *out, Executor &executor,
+                       MathMode mode) {
+    size_t grain = BATCH_BLOCK * 16;
+    executor.parallel_for(rows, grain, [&](size_t, size_t begin, size_t end) {
+        std::vector<const N *> shifted(program.variables.size());
+        for (size_t i = 0; i < shifted.size(); ++i)
+            shifted[i] = columns[i] + begin;
+        evaluate_batch(program, shifted.data(), end - begin, out + begin, mode);
+    });
+}
+
+template void evaluate_parallel<double>(const Program &, const double *const *, size_t, double *, Executor &, MathMode);
+template void evaluate_parallel<long double>(const Program &, const long double *const *, size_t, long double *,
+                                             Executor &, MathMode);
@@ -0,0 +1,63 @@
+#ifndef EXECUTOR_HPP
+#define EXECUTOR_HPP
+
+#include "Bytecode.hpp"
+#include "Kernels.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с перехватом работы: диапазон делится на куски, куски раскладываются
+// по очередям потоков, поток берёт работу с конца своей очереди, а опустев — крадёт
+// из начала чужой. Вызывающий поток тоже участвует (его номер 0).
+// Дерево выражения разделять между потоками можно только для чтения (simplify и specify
+// меняют узлы), поэтому параллельное вычисление идёт по неизменяемой Program.
+class Executor {
+public:
+    explicit Executor(size_t threads = std::thread::hardware_concurrency());
+    ~Executor();
+    Executor(const Executor &) = delete;
+    Executor& operator=(const Executor &) = delete;
+
+    // число потоков вместе с вызывающим
+    size_t size() const;
+    // f(worker, begin, end) для кусков [0, count) длиной не больше grain; возвращается,
+    // когда выполнены все куски. Вызовы parallel_for выполняются по одному.
+    // Если f бросил исключение, остальные куски отменяются, а первое исключение бросается отсюда.
+    void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t, size_t)> &);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::pair<size_t, size_t>> ranges;
+    };
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::mutex mutex, call;
+    std::condition_variable wake, done;
+    const std::function<void(size_t, size_t, size_t)> *job = nullptr;
+    std::atomic<size_t> remaining = 0;
+    // первое исключение текущего вызова; failed — куски больше не выполняются
+    std::exception_ptr error;
+    std::atomic<bool> failed = false;
+    size_t generation = 0;
+    bool stop = false;
+
+    bool pop(size_t, std::pair<size_t, size_t> &);
+    void work(size_t);
+    void loop(size_t);
+};
+
+// Вычисление программы по строкам столбцов (как evaluate_batch), куски строк — по потокам.
+// Результат не зависит от числа потоков: каждая строка пишется на своё место.
+template <typename N>
+void evaluate_parallel(const Program &, const N *const *columns, size_t rows, N *out, Executor &,
+                       MathMode mode = MathMode::ACCURATE);
+
+#endif
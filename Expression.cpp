@@ -1,87 +1,276 @@
 #include "Expression.hpp"
+#include "Parser.hpp"
+#include "Arena.hpp"
+#include "Rewrite.hpp"
+#include "Stats.hpp"
+#include "Printer.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <vector>
 
-std::unique_ptr<Expression> Expression::create(T val) {
-    return std::make_unique<Constant>(val);
-}
-std::unique_ptr<Expression> Expression::create(std::string source) {
-    while (source.length() > 0) {
-        if (source[0] == ' ') {
-            source = source.substr(1);
-            continue;
-        } else if (source.back() == ' ') {
-            source.pop_back();
+//---------------//
+//---TRAVERSAL---//
+//---------------//
+// Обход снизу вверх с явным стеком: visit(node, results, n) получает результаты n операндов узла
+// в конце results и заменяет их результатом самого узла. depth — наибольшая глубина обхода.
+template <typename R, typename N, typename F>
+static R fold(const BasicExpression<N> &root, F visit, size_t &depth) {
+    struct Frame {
+        const BasicExpression<N> *node;
+        int next;
+    };
+    std::vector<Frame> stack = {{&root, 0}};
+    std::vector<R> results;
+    depth = 1;
+    while (!stack.empty()) {
+        Frame &top = stack.back();
+        if (const BasicExpression<N> *child = top.node->operand(top.next)) {
+            ++top.next;
+            if (!child->operand(0)) {
+                visit(*child, results, 0);
+                continue;
+            }
+            stack.push_back({child, 0});
+            depth = std::max(depth, stack.size());
             continue;
-        } else if (source[0] == '(' && find_close(source.substr(1)) == source.length() - 2) {
-            source = source.substr(1, source.length() - 1);
+        }
+        Frame done = top;
+        stack.pop_back();
+        visit(*done.node, results, done.next);
+    }
+    return std::move(results.back());
+}
+
+// Разрушение без рекурсии: у каждого узла операнды забираются до вызова его деструктора
+template <typename N>
+static void release(BasicExpression<N> &node) {
+    std::vector<std::unique_ptr<BasicExpression<N>>> pending;
+    node.detach(pending);
+    while (!pending.empty()) {
+        std::unique_ptr<BasicExpression<N>> next = std::move(pending.back());
+        pending.pop_back();
+        if (next) next->detach(pending);
+    }
+}
+template <typename N>
+static bool has_operands(const std::unique_ptr<BasicExpression<N>> &node) {
+    return node && node->operand(0);
+}
+
+template <typename N>
+static std::unique_ptr<BasicExpression<N>> clone_tree(const BasicExpression<N> &root) {
+    size_t depth;
+    return fold<std::unique_ptr<BasicExpression<N>>>(root, [](const BasicExpression<N> &node,
+                                                             std::vector<std::unique_ptr<BasicExpression<N>>> &copies, int n) {
+        if (n == 0) return copies.push_back(node.clone());
+        STATS(statistics().clones.add();)
+        if (n == 1) {
+            copies.back() = std::make_unique<BasicUnary<N>>(node.operation(), std::move(copies.back()));
+            return;
+        }
+        std::unique_ptr<BasicExpression<N>> right = std::move(copies.back());
+        copies.pop_back();
+        copies.back() = std::make_unique<BasicBinary<N>>(node.operation(), std::move(copies.back()), std::move(right));
+    }, depth);
+}
+
+// Отдельный цикл без fold: вычисление — самый частый обход, и стеки здесь переиспользуются
+// между вызовами (вычисление листа не приводит к повторному входу)
+template <typename N>
+static N evaluate_tree(const BasicExpression<N> &root, const std::map<std::string, N> &x) {
+    thread_local std::vector<std::pair<const BasicExpression<N> *, int>> stack;
+    thread_local std::vector<N> values;
+    stack.assign(1, {&root, 0});
+    values.clear();
+    STATS(size_t depth = 1;)
+    while (!stack.empty()) {
+        auto &[node, next] = stack.back();
+        if (const BasicExpression<N> *child = node->operand(next)) {
+            ++next;
+            if (child->operand(0)) {
+                stack.push_back({child, 0});
+                STATS(depth = std::max(depth, stack.size());)
+            } else {
+                values.push_back(child->evaluate(x));
+            }
             continue;
         }
-        break;
+        if (next == 1) {
+            STATS(statistics().evaluate_calls[2].add();)
+            values.back() = apply_unary(node->operation(), values.back());
+        } else {
+            STATS(statistics().evaluate_calls[3].add();)
+            N r = values.back();
+            values.pop_back();
+            values.back() = apply_binary(node->operation(), values.back(), r);
+        }
+        stack.pop_back();
     }
+    STATS(statistics().evaluate_depth.max(depth);)
+    return values.back();
+}
 
-    //---CONSTANT---//
-    if (source.length() == 0)
-        return std::make_unique<Constant>(0);
-        //throw std::runtime_error("Empty expression");
-    if (is_number(source))
-        return std::make_unique<Constant>(to_number<T>(source));
+// Производные операндов уже посчитаны; правила те же, что были у рекурсивного differentiate
+template <typename N>
+static std::unique_ptr<BasicExpression<N>> differentiate_tree(const BasicExpression<N> &root, const std::string &x) {
+    using E = std::unique_ptr<BasicExpression<N>>;
+    auto binary = [](char op, E l, E r) -> E { return std::make_unique<BasicBinary<N>>(op, std::move(l), std::move(r)); };
+    auto unary = [](char op, E e) -> E { return std::make_unique<BasicUnary<N>>(op, std::move(e)); };
+    auto constant = [](N value) -> E { return std::make_unique<BasicConstant<N>>(value); };
+    size_t depth;
+    E result = fold<E>(root, [&](const BasicExpression<N> &node, std::vector<E> &derivatives, int n) {
+        if (n == 0) return derivatives.push_back(node.differentiate(x));
+        char op = node.operation();
+        const BasicExpression<N> &a = *node.operand(0);
+        E d;
+        if (n == 1) {
+            E da = std::move(derivatives.back());
+            switch (op) {
+                case 's': d = binary('*', unary('c', a.clone()), std::move(da)); break;
+                case 'c': d = binary('*', binary('-', constant(0), unary('s', a.clone())), std::move(da)); break;
+                case 'l': d = binary('/', std::move(da), a.clone()); break;
+                case 'e': d = binary('*', node.clone(), std::move(da)); break;
+                default: throw std::runtime_error(std::string("Unknown operator: ") + op);
+            }
+            derivatives.back() = std::move(d);
+            return;
+        }
+        const BasicExpression<N> &b = *node.operand(1);
+        E db = std::move(derivatives.back());
+        derivatives.pop_back();
+        E da = std::move(derivatives.back());
+        switch (op) {
+            case '+': case '-': d = binary(op, std::move(da), std::move(db)); break;
+            case '*':
+                d = binary('+', binary('*', std::move(da), b.clone()), binary('*', a.clone(), std::move(db)));
+                break;
+            case '/':
+                d = binary('/',
+                    binary('-', binary('*', std::move(da), b.clone()), binary('*', a.clone(), std::move(db))),
+                    binary('^', b.clone(), constant(2)));
+                break;
+            case '^':
+                // (exp(b * ln(a)))' = exp(b * ln(a)) * (b' * ln(a) + b * (a' / a))
+                d = binary('*',
+                    unary('e', binary('*', b.clone(), unary('l', a.clone()))),
+                    binary('+',
+                        binary('*', std::move(db), unary('l', a.clone())),
+                        binary('*', b.clone(), binary('/', std::move(da), a.clone()))));
+                break;
+            default: throw std::runtime_error(std::string("Unknown operator: ") + op);
+        }
+        derivatives.back() = std::move(d);
+    }, depth);
+    STATS(statistics().differentiate_depth.max(depth);)
+    return result;
+}
 
-    //---VARIABLE--//
-    if (is_name(source)) {
-        if constexpr (std::is_same_v<T, std::complex<long double>>) {
-            if (source[0] == 'i') return std::make_unique<Constant>(std::complex<long double>(0, 1));
+// Снизу вверх: замена, которую вернул simplify_node операнда, ставится на его место в родителе
+template <typename N>
+static std::pair<std::unique_ptr<BasicExpression<N>>, int> simplify_tree(BasicExpression<N> &root) {
+    struct Frame {
+        BasicExpression<N> *node;
+        int next;
+    };
+    std::vector<Frame> stack = {{&root, 0}};
+    std::vector<int> types;
+    std::pair<std::unique_ptr<BasicExpression<N>>, int> result;
+    while (!stack.empty()) {
+        Frame &top = stack.back();
+        if (std::unique_ptr<BasicExpression<N>> *slot = top.node->operand_slot(top.next)) {
+            ++top.next;
+            stack.push_back({slot->get(), 0});
+            continue;
         }
-        return std::make_unique<Variable>(source);
+        result = top.node->simplify_node(types.data() + types.size() - top.next);
+        types.resize(types.size() - top.next);
+        types.push_back(result.second);
+        stack.pop_back();
+        if (!stack.empty() && result.first)
+            *stack.back().node->operand_slot(stack.back().next - 1) = std::move(result.first);
     }
+    return result;
+}
 
-    //----UNARY----//
-    for (auto op: UNARY_OPERATORS) {
-        if (source.length() < op.second.length()) continue;
-        bool op_found = true;
-        for (int i = 0; i < op.second.length(); ++i)
-            if (source[i] != op.second[i]) op_found = false;
-        if (!op_found) continue;
-        if (source.length() < op.second.length() + 2 || source[op.second.length()] != '(')
-            throw std::runtime_error(std::string("Expected a '(...)' after '") + op.second + "': " + source);
-        std::string new_source = source.substr(op.second.length() + 1);
-        size_t closed = find_close(new_source);
-        if (closed != new_source.length() - 1) break;
-        new_source = new_source.substr(0, closed);
-        return std::make_unique<Unary>(op.first, Expression::create(new_source));
+template <typename N>
+static void specify_tree(BasicExpression<N> &root, const std::string &x, N val) {
+    std::vector<BasicExpression<N> *> stack = {&root};
+    while (!stack.empty()) {
+        BasicExpression<N> *node = stack.back();
+        stack.pop_back();
+        for (int i = 0; std::unique_ptr<BasicExpression<N>> *slot = node->operand_slot(i); ++i) {
+            if ((*slot)->operation() != 'v') stack.push_back(slot->get());
+            else if (std::unique_ptr<BasicExpression<N>> value = (*slot)->specify(x, val)) *slot = std::move(value);
+        }
     }
+}
 
-    //----BINARY----//
-    size_t sep = find_operator(source);
-    if (sep == std::string::npos)
-        throw std::runtime_error(std::string("Invalid expression: ") + source);
-    std::string l_source = source.substr(0, sep);
-    std::string r_source = source.substr(sep + 1);
-    return std::make_unique<Binary>(source[sep], Expression::create(l_source), Expression::create(r_source));
+template <typename N>
+void* BasicExpression<N>::operator new(size_t size) {
+    STATS(statistics().allocations.add();)
+    // арена хранит только деревья над T: её clear() разрушает узлы как Expression
+    if constexpr (std::is_same_v<N, T>) return ExpressionArena::allocate_node(size);
+    return ::operator new(size);
+}
+template <typename N>
+void BasicExpression<N>::operator delete(void *p) {
+    STATS(statistics().deallocations.add();)
+    if constexpr (std::is_same_v<N, T>) ExpressionArena::free_node(p);
+    else ::operator delete(p);
+}
+
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicExpression<N>::create(N val) {
+    return std::make_unique<BasicConstant<N>>(val);
+}
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicExpression<N>::create(std::string_view source) {
+    STATS(PhaseTimer timer(PARSE);)
+    return BasicParser<N>(source).parse();
 }
 
 
 //--------------//
 //---CONSTANT---//
 //--------------//
-Constant::Constant(T val) : value(val) {}
-std::unique_ptr<Expression> Constant::clone() const {
-    return std::make_unique<Constant>(value);
-}
-T Constant::evaluate(const std::map<std::string, T> &x) const {
+template <typename N>
+BasicConstant<N>::BasicConstant(N val) : value(val) {}
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicConstant<N>::clone() const {
+    STATS(statistics().clones.add();)
+    return std::make_unique<BasicConstant<N>>(value);
+}
+template <typename N>
+N BasicConstant<N>::evaluate(const std::map<std::string, N> &x) const {
+    STATS(statistics().evaluate_calls[0].add();)
     return value;
 }
-std::unique_ptr<Expression> Constant::differentiate(std::string x) const {
-    return std::make_unique<Constant>(0);
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicConstant<N>::differentiate(std::string x) const {
+    return std::make_unique<BasicConstant<N>>(0);
 }
-std::unique_ptr<Expression> Constant::specify(std::string x, T val) {
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicConstant<N>::specify(std::string x, N val) {
     return nullptr;
 }
-std::string Constant::to_string() const {
-    return delete_zeros(std::to_string(value));
+template <typename N>
+std::string BasicConstant<N>::to_string() const {
+    std::string out;
+    append_number(out, value);
+    return out;
+}
+template <typename N>
+char BasicConstant<N>::operation() const {
+    return 'n';
+}
+template <typename N>
+N BasicConstant<N>::get_value() const {
+    return value;
 }
-std::pair<std::unique_ptr<Expression>, int> Constant::simplify() {
+template <typename N>
+std::pair<std::unique_ptr<BasicExpression<N>>, int> BasicConstant<N>::simplify() {
     return {nullptr, -1};
 }
 
@@ -89,26 +278,43 @@ std::pair<std::unique_ptr<Expression>, int> Constant::simplify() {
 //--------------//
 //---VARIABLE---//
 //--------------//
-Variable::Variable(std::string x) : name(x) {}
-std::unique_ptr<Expression> Variable::clone() const {
-    return std::make_unique<Variable>(name);
-}
-T Variable::evaluate(const std::map<std::string, T> &x) const {
+template <typename N>
+BasicVariable<N>::BasicVariable(std::string x) : name(x) {}
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicVariable<N>::clone() const {
+    STATS(statistics().clones.add();)
+    return std::make_unique<BasicVariable<N>>(name);
+}
+template <typename N>
+N BasicVariable<N>::evaluate(const std::map<std::string, N> &x) const {
+    STATS(statistics().evaluate_calls[1].add();)
     auto it = x.find(name);
-    return (it != x.end()) ? it->second : T{};
+    return (it != x.end()) ? it->second : N{};
 }
-std::unique_ptr<Expression> Variable::differentiate(std::string x) const {
-    return std::make_unique<Constant>(x == name ? 1 : 0);
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicVariable<N>::differentiate(std::string x) const {
+    return std::make_unique<BasicConstant<N>>(x == name ? 1 : 0);
 }
-std::unique_ptr<Expression> Variable::specify(std::string x, T val) {
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicVariable<N>::specify(std::string x, N val) {
     if (x == name)
-        return std::make_unique<Constant>(val);
+        return std::make_unique<BasicConstant<N>>(val);
     return nullptr;
 }
-std::string Variable::to_string() const {
+template <typename N>
+std::string BasicVariable<N>::to_string() const {
     return {name};
 }
-std::pair<std::unique_ptr<Expression>, int> Variable::simplify() {
+template <typename N>
+char BasicVariable<N>::operation() const {
+    return 'v';
+}
+template <typename N>
+const std::string& BasicVariable<N>::get_name() const {
+    return name;
+}
+template <typename N>
+std::pair<std::unique_ptr<BasicExpression<N>>, int> BasicVariable<N>::simplify() {
     return {nullptr, 0};
 }
 
@@ -117,127 +323,111 @@ std::pair<std::unique_ptr<Expression>, int> Variable::simplify() {
 //--------------//
 //----BINARY----//
 //--------------//
-Binary::Binary(char operation, std::unique_ptr<Expression> l, std::unique_ptr<Expression> r)
+template <typename N>
+BasicBinary<N>::BasicBinary(char operation, std::unique_ptr<BasicExpression<N>> l, std::unique_ptr<BasicExpression<N>> r)
     : op(operation), left(std::move(l)), right(std::move(r)) {}
-Binary::Binary(const Binary &other) {
+template <typename N>
+BasicBinary<N>::BasicBinary(const BasicBinary &other) {
     op = other.op;
     left = std::move(other.left->clone());
     right = std::move(other.right->clone());
 }
-Binary& Binary::operator=(const Binary &other) {
+template <typename N>
+BasicBinary<N>& BasicBinary<N>::operator=(const BasicBinary &other) {
     if (this == &other) return *this;
     op = other.op;
     left = std::move(other.left->clone());
     right = std::move(other.right->clone());
     return *this;
 }
-std::unique_ptr<Expression> Binary::clone() const {
-    return std::make_unique<Binary>(op, left->clone(), right->clone());
+template <typename N>
+BasicBinary<N>::~BasicBinary() {
+    if (has_operands(left) || has_operands(right)) release<N>(*this);
 }
-T Binary::evaluate(const std::map<std::string, T> &x) const {
-    T l = left->evaluate(x);
-    T r = right->evaluate(x);
-    switch (op) {
-        case '+': return l + r;
-        case '-': return l - r;
-        case '*': return l * r;
-        case '/': return l / r;
-        case '^': return pow(l, r);
-        default: throw std::runtime_error(std::string("Unknown operator: ") + op);
-    }
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicBinary<N>::clone() const {
+    return clone_tree<N>(*this);
 }
-std::unique_ptr<Expression> Binary::differentiate(std::string x) const {
-    std::unique_ptr<Expression> l = left->differentiate(x);
-    std::unique_ptr<Expression> r = right->differentiate(x);
-    switch (op) {
-        case '+': case '-': return std::make_unique<Binary>(op, std::move(l), std::move(r));
-        case '*': return
-            std::make_unique<Binary>('+',
-                std::make_unique<Binary>('*', std::move(l), right->clone()),
-                std::make_unique<Binary>('*', left->clone(), std::move(r)));
-        case '/': return
-            std::make_unique<Binary>('/',
-                std::make_unique<Binary>('-',
-                    std::make_unique<Binary>('*', std::move(l), right->clone()),
-                    std::make_unique<Binary>('*', left->clone(), std::move(r))),
-                std::make_unique<Binary>('^', right->clone(), std::make_unique<Constant>(2)));
-        case '^': return
-            (std::make_unique<Unary>('e',
-                std::make_unique<Binary>('*',
-                    right->clone(),
-                    std::make_unique<Unary>('l', left->clone())))
-            )->differentiate(x);
-        default: throw std::runtime_error(std::string("Unknown operator: ") + op);
-    }
+template <typename N>
+N BasicBinary<N>::evaluate(const std::map<std::string, N> &x) const {
+    return evaluate_tree<N>(*this, x);
+}
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicBinary<N>::differentiate(std::string x) const {
+    return differentiate_tree<N>(*this, x);
 }
-std::unique_ptr<Expression> Binary::specify(std::string x, T val) {
-    std::unique_ptr<Expression> new_left = left->specify(x, val);
-    std::unique_ptr<Expression> new_right = right->specify(x, val);
-    if (new_left)
-        left = std::move(new_left);
-    if (new_right)
-        right = std::move(new_right);
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicBinary<N>::specify(std::string x, N val) {
+    specify_tree<N>(*this, x, val);
     return nullptr;
 }
-std::string Binary::to_string() const {
-    std::string l = left->to_string(), r = right->to_string();
-    if (op == '^') return l + op + r;
-    if (op == '+') {
-        if (l.size() > 1 && l[0] == '(' && find_close(l.substr(1)) == l.length() - 2) {
-            l.pop_back();
-            l = l.substr(1);
-        }
-    }
-    if (op == '-' && l == "0") return "(-" + r + ")";
-    return '(' + l + ' ' + op + ' ' + r + ')';
-}
-std::pair<std::unique_ptr<Expression>, int> Binary::simplify() {
-    auto [new_left, left_type] = left->simplify();
-    auto [new_right, right_type] = right->simplify();
-    if (new_left != nullptr)
-        left = std::move(new_left);
-    if (new_right != nullptr)
-        right = std::move(new_right);
-
-    T left_val = (left_type == -1 ? left->evaluate() : -2);
-    T right_val = (right_type == -1 ? right->evaluate() : -2);
+template <typename N>
+std::string BasicBinary<N>::to_string() const {
+    return ::to_string(*this, Parentheses::FULL);
+}
+template <typename N>
+char BasicBinary<N>::operation() const {
+    return op;
+}
+template <typename N>
+const BasicExpression<N>* BasicBinary<N>::operand(int i) const {
+    return i == 0 ? left.get() : (i == 1 ? right.get() : nullptr);
+}
+template <typename N>
+std::unique_ptr<BasicExpression<N>>* BasicBinary<N>::operand_slot(int i) {
+    return i == 0 ? &left : (i == 1 ? &right : nullptr);
+}
+template <typename N>
+void BasicBinary<N>::detach(std::vector<std::unique_ptr<BasicExpression<N>>> &out) {
+    out.push_back(std::move(left));
+    out.push_back(std::move(right));
+}
+template <typename N>
+std::pair<std::unique_ptr<BasicExpression<N>>, int> BasicBinary<N>::simplify() {
+    return simplify_tree<N>(*this);
+}
+template <typename N>
+std::pair<std::unique_ptr<BasicExpression<N>>, int> BasicBinary<N>::simplify_node(const int *types) {
+    int left_type = types[0], right_type = types[1];
+    N left_val = (left_type == -1 ? left->evaluate() : N(-2));
+    N right_val = (right_type == -1 ? right->evaluate() : N(-2));
 
     if (left_type == -1 && right_type == -1) // в выражении нет переменных, можно вычислить
-        return {std::make_unique<Constant>(evaluate()), -1};
+        return {std::make_unique<BasicConstant<N>>(apply_binary(op, left_val, right_val)), -1};
 
     switch (op) {
         case '+':
-            if (left_val == 0)
+            if (left_val == N(0))
                 return {std::move(right), right_type};
-            if (right_val == 0)
+            if (right_val == N(0))
                 return {std::move(left), left_type};
             break;
         case '-':
-            if (left_val == 0)
+            if (left_val == N(0))
                 return {nullptr, 1};
-            if (right_val == 0)
+            if (right_val == N(0))
                 return {std::move(left), left_type};
             break;
         case '*':
-            if ((left_val == 0 || right_val == 0))
-                return {std::make_unique<Constant>(0), -1};
-            if (left_val == 1)
+            if ((left_val == N(0) || right_val == N(0)))
+                return {std::make_unique<BasicConstant<N>>(0), -1};
+            if (left_val == N(1))
                 return {std::move(right), right_type};
-            if (right_val == 1)
+            if (right_val == N(1))
                 return {std::move(left), left_type};
             break;
         case '/':
-            if (left_val == 0)
-                return {std::make_unique<Constant>(0), -1};
-            if (right_val == 1)
+            if (left_val == N(0))
+                return {std::make_unique<BasicConstant<N>>(0), -1};
+            if (right_val == N(1))
                 return {std::move(left), left_type};
             break;
         case '^':
-            if (left_val == 0)
-                return {std::make_unique<Constant>(0), -1};
-            if (left_val == 1 || right_val == 0)
-                return {std::make_unique<Constant>(1), -1};
-            if (right_val == 1)
+            if (left_val == N(0))
+                return {std::make_unique<BasicConstant<N>>(0), -1};
+            if (left_val == N(1) || right_val == N(0))
+                return {std::make_unique<BasicConstant<N>>(1), -1};
+            if (right_val == N(1))
                 return {std::move(left), left_type};
             break;
     }
@@ -248,82 +438,70 @@ std::pair<std::unique_ptr<Expression>, int> Binary::simplify() {
 //-------------//
 //----Unary----//
 //-------------//
-Unary::Unary(char operation, std::unique_ptr<Expression> expression) 
+template <typename N>
+BasicUnary<N>::BasicUnary(char operation, std::unique_ptr<BasicExpression<N>> expression) 
     : op(operation), expr(std::move(expression)) {}
-Unary::Unary(const Unary &other) {
+template <typename N>
+BasicUnary<N>::BasicUnary(const BasicUnary &other) {
     op = other.op;
     expr = std::move(other.expr->clone());
 }
-Unary& Unary::operator=(const Unary &other) {
+template <typename N>
+BasicUnary<N>& BasicUnary<N>::operator=(const BasicUnary &other) {
     if (this == &other) return *this;
     op = other.op;
     expr = std::move(other.expr->clone());
     return *this;
 }
-std::unique_ptr<Expression> Unary::clone() const {
-    return std::make_unique<Unary>(op, expr->clone());
+template <typename N>
+BasicUnary<N>::~BasicUnary() {
+    if (has_operands(expr)) release<N>(*this);
 }
-T Unary::evaluate(const std::map<std::string, T> &x) const {
-    auto res = expr->evaluate(x);
-    switch (op) {
-        case 's': return sin(res);
-        case 'c': return cos(res);
-        case 'l': return log(res);
-        case 'e': return exp(res);
-        default: throw std::runtime_error(std::string("Unknown operator: ") + op);
-    }
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicUnary<N>::clone() const {
+    return clone_tree<N>(*this);
 }
-std::unique_ptr<Expression> Unary::differentiate(std::string x) const {
-    std::unique_ptr<Expression> derivative = expr->differentiate(x);
-    switch (op) {
-        case 's': return
-            std::make_unique<Binary>('*',
-                std::make_unique<Unary>('c', expr->clone()),
-                std::move(derivative));
-        case 'c': return
-            std::make_unique<Binary>('*',
-                std::make_unique<Binary>('-',
-                    std::make_unique<Constant>(0),
-                    std::make_unique<Unary>('s', expr->clone())),
-                std::move(derivative));
-        case 'l': return
-            std::make_unique<Binary>('/',
-                std::move(derivative),
-                expr->clone());
-        case 'e': return
-            std::make_unique<Binary>('*',
-                clone(),
-                std::move(derivative));
-        default: throw std::runtime_error(std::string("Unknown operator: ") + op);
-    }
+template <typename N>
+N BasicUnary<N>::evaluate(const std::map<std::string, N> &x) const {
+    return evaluate_tree<N>(*this, x);
 }
-std::unique_ptr<Expression> Unary::specify(std::string x, T val) {
-    std::unique_ptr<Expression> new_expr = expr->specify(x, val);
-    if (new_expr)
-        expr = std::move(new_expr);
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicUnary<N>::differentiate(std::string x) const {
+    return differentiate_tree<N>(*this, x);
+}
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicUnary<N>::specify(std::string x, N val) {
+    specify_tree<N>(*this, x, val);
     return nullptr;
 }
-std::string Unary::to_string() const {
-    std::string operation = "";
-    switch (op) {
-        case 's': operation = "sin"; break;
-        case 'c': operation = "cos"; break;
-        case 'l': operation = "ln"; break;
-        case 'e': operation = "exp"; break;
-    }
-    std::string e = expr->to_string();
-    if (e.size() > 1 && e[0] == '(' && e.back() == ')') {
-        e.pop_back();
-        e = e.substr(1);
-    }
-    return operation + '(' + e + ')';
+template <typename N>
+std::string BasicUnary<N>::to_string() const {
+    return ::to_string(*this, Parentheses::FULL);
 }
-std::pair<std::unique_ptr<Expression>, int> Unary::simplify() {
-    auto [new_expr, type] = expr->simplify();
-    if (new_expr)
-        expr = std::move(new_expr);
-    if (type == -1)
-        return {std::make_unique<Constant>(evaluate()), -1};
+template <typename N>
+char BasicUnary<N>::operation() const {
+    return op;
+}
+template <typename N>
+const BasicExpression<N>* BasicUnary<N>::operand(int i) const {
+    return i == 0 ? expr.get() : nullptr;
+}
+template <typename N>
+std::unique_ptr<BasicExpression<N>>* BasicUnary<N>::operand_slot(int i) {
+    return i == 0 ? &expr : nullptr;
+}
+template <typename N>
+void BasicUnary<N>::detach(std::vector<std::unique_ptr<BasicExpression<N>>> &out) {
+    out.push_back(std::move(expr));
+}
+template <typename N>
+std::pair<std::unique_ptr<BasicExpression<N>>, int> BasicUnary<N>::simplify() {
+    return simplify_tree<N>(*this);
+}
+template <typename N>
+std::pair<std::unique_ptr<BasicExpression<N>>, int> BasicUnary<N>::simplify_node(const int *types) {
+    if (types[0] == -1)
+        return {std::make_unique<BasicConstant<N>>(apply_unary(op, expr->evaluate())), -1};
     return {nullptr, 1};
 }
 
@@ -331,23 +509,110 @@ std::pair<std::unique_ptr<Expression>, int> Unary::simplify() {
 //-------------//
 //----OTHER----//
 //-------------//
-void simplify(std::unique_ptr<Expression> &expr) {
+// Быстрый проход тождеств с 0 и 1, затем каноникализация правилами до неподвижной точки
+// (правила переписывания работают в NodeStore над T, для других типов — только первый проход)
+template <typename N>
+void simplify(std::unique_ptr<BasicExpression<N>> &expr) {
+    STATS(PhaseTimer timer(SIMPLIFY);)
+    STATS(statistics().simplify_calls.add();)
+    STATS(statistics().nodes_before_simplify.add(count_nodes(*expr));)
+    STATS(statistics().depth_before_simplify.max(tree_depth(*expr));)
     auto [new_expr, type] = expr->simplify();
     if (new_expr)
         expr = std::move(new_expr);
-}
-bool is_number(std::string source) {
+    if constexpr (std::is_same_v<N, T>) {
+        if (std::unique_ptr<Expression> rewritten = canonicalize(*expr))
+            expr = std::move(rewritten);
+    }
+    STATS(statistics().nodes_after_simplify.add(count_nodes(*expr));)
+    STATS(statistics().depth_after_simplify.max(tree_depth(*expr));)
+}
+// Один проход снизу вверх строит копию: связанные переменные становятся константами, узел с постоянными
+// операндами сразу сворачивается в константу, остальные проходят тождества simplify_node. Исходное
+// дерево не меняется; затем, как обычно, simplify
+template <typename N>
+std::unique_ptr<BasicExpression<N>> specialize(const BasicExpression<N> &expr, const std::map<std::string, N> &bindings) {
+    using E = std::unique_ptr<BasicExpression<N>>;
+    std::vector<int> types;
+    size_t depth;
+    E result = fold<E>(expr, [&](const BasicExpression<N> &node, std::vector<E> &nodes, int n) {
+        char op = node.operation();
+        if (n == 0) {
+            auto it = (op == 'v' ? bindings.find(static_cast<const BasicVariable<N> &>(node).get_name()) : bindings.end());
+            nodes.push_back(it != bindings.end() ? std::make_unique<BasicConstant<N>>(it->second) : node.clone());
+            types.push_back(op == 'v' && it == bindings.end() ? 0 : -1);
+            return;
+        }
+        E made;
+        if (n == 1) {
+            made = std::make_unique<BasicUnary<N>>(op, std::move(nodes.back()));
+        } else {
+            E right = std::move(nodes.back());
+            nodes.pop_back();
+            made = std::make_unique<BasicBinary<N>>(op, std::move(nodes.back()), std::move(right));
+        }
+        auto [replacement, type] = made->simplify_node(types.data() + types.size() - n);
+        types.resize(types.size() - n);
+        types.push_back(type);
+        nodes.back() = replacement ? std::move(replacement) : std::move(made);
+    }, depth);
+    simplify(result);
+    return result;
+}
+template <typename N>
+size_t tree_depth(const BasicExpression<N> &expr) {
+    size_t depth = 0;
+    std::vector<std::pair<const BasicExpression<N> *, size_t>> stack = {{&expr, 1}};
+    while (!stack.empty()) {
+        auto [node, level] = stack.back();
+        stack.pop_back();
+        depth = std::max(depth, level);
+        for (int i = 0; node->operand(i); ++i)
+            stack.push_back({node->operand(i), level + 1});
+    }
+    return depth;
+}
+template <typename N>
+size_t count_nodes(const BasicExpression<N> &expr) {
+    size_t count = 0;
+    std::vector<const BasicExpression<N> *> stack = {&expr};
+    while (!stack.empty()) {
+        const BasicExpression<N> *node = stack.back();
+        stack.pop_back();
+        ++count;
+        for (int i = 0; node->operand(i); ++i)
+            stack.push_back(node->operand(i));
+    }
+    return count;
+}
+#define DIFFERENTIATOR_INSTANTIATE(N) \
+    template class BasicExpression<N>; \
+    template class BasicConstant<N>; \
+    template class BasicVariable<N>; \
+    template class BasicBinary<N>; \
+    template class BasicUnary<N>; \
+    template void simplify(std::unique_ptr<BasicExpression<N>> &); \
+    template std::unique_ptr<BasicExpression<N>> specialize(const BasicExpression<N> &, const std::map<std::string, N> &); \
+    template size_t count_nodes(const BasicExpression<N> &); \
+    template size_t tree_depth(const BasicExpression<N> &);
+DIFFERENTIATOR_INSTANTIATE(float)
+DIFFERENTIATOR_INSTANTIATE(double)
+DIFFERENTIATOR_INSTANTIATE(long double)
+DIFFERENTIATOR_INSTANTIATE(std::complex<double>)
+#undef DIFFERENTIATOR_INSTANTIATE
+
+bool is_number(std::string_view source) {
     if (source.length() == 0) return false;
     int dot_count = 0;
     bool im = (source.back() == 'i');
-    if (im) source.pop_back();
+    if (im) source.remove_suffix(1);
     for (char c : source) {
         if (!(('0' <= c && c <= '9') || c == '.' || c == ',')) return false;
         if (c == '.' || c == ',') ++dot_count;
     }
     return dot_count <= 1;
 }
-bool is_name(std::string source) {
+bool is_name(std::string_view source) {
     if (!source.empty() && ('0' <= source[0] && source[0] <= '9'))
         return false;
     if (source == "sin" || source == "cos" || source == "ln" || source == "exp")
@@ -367,21 +632,6 @@ size_t find_close(std::string source) {
     }
     return std::string::npos;
 }
-size_t find_operator(std::string source) {
-    size_t f = 0, i = std::string::npos, j = std::string::npos, k = std::string::npos;
-    while (f < source.length()) {
-        if (source[f] == '+' || source[f] == '-') i = f;
-        if (source[f] == '*' || source[f] == '/') j = f;
-        if (source[f] == '^') k = f;
-        if (source[f] == '(') {
-            f += find_close(source.substr(f + 1)) + 1;
-            if (f == std::string::npos)
-                throw std::runtime_error(std::string("Expected a ')': ") + source.substr(f));
-        }
-        ++f;
-    }
-    return (i == std::string::npos ? (j == std::string::npos ? k : j) : i);
-}
 std::string delete_zeros(std::string s) {
     int min_sz = 1 + (!s.empty() && s[0] == '-');
     while (s.length() > min_sz && s.back() == '0')
@@ -2,96 +2,220 @@
 #define EXPRESSION_HPP
 
 #include <complex>
+#include <cstdint>
 #include <memory>
 #include <map>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <vector>
 
 const std::pair<char, std::string> UNARY_OPERATORS[4] = {{'s', "sin"}, {'c', "cos"}, {'l', "ln"}, {'e', "exp"}};
 
 using T = long double;
 
-class Expression {
+template <typename N>
+struct is_complex : std::false_type {};
+template <typename N>
+struct is_complex<std::complex<N>> : std::true_type {};
+template <typename N>
+constexpr bool is_complex_v = is_complex<N>::value;
+
+// Дерево выражения над числовым типом N. Явно инстанцировано для float, double, long double
+// и std::complex<double> (Expression.cpp); остальная библиотека — DAG, байткод, ядра — работает
+// с Expression = BasicExpression<T>. Узлы других типов берут память из кучи, а не из арены.
+// Все обходы дерева — разбор, вычисление, производная, копирование, упрощение, печать
+// и разрушение — идут с явным стеком: глубина дерева ограничена памятью, а не стеком потока.
+template <typename N>
+class BasicExpression {
 public:
-    virtual ~Expression() = default;
-    virtual std::unique_ptr<Expression> clone() const = 0;
+    using Number = N;
 
-    static std::unique_ptr<Expression> create(T);
-    static std::unique_ptr<Expression> create(std::string);
+    virtual ~BasicExpression() = default;
+    virtual std::unique_ptr<BasicExpression> clone() const = 0;
 
-    virtual T evaluate(const std::map<std::string, T>& = {}) const = 0;
-    virtual std::unique_ptr<Expression> differentiate(std::string x) const = 0;
-    virtual std::unique_ptr<Expression> specify(std::string, T) = 0;
+    static std::unique_ptr<BasicExpression> create(N);
+    static std::unique_ptr<BasicExpression> create(std::string_view);
+
+    virtual N evaluate(const std::map<std::string, N>& = {}) const = 0;
+    virtual std::unique_ptr<BasicExpression> differentiate(std::string x) const = 0;
+    virtual std::unique_ptr<BasicExpression> specify(std::string, N) = 0;
     virtual std::string to_string() const = 0;
 
+    // Устройство узла для внешних обходов: 'n' — константа, 'v' — переменная, иначе символ операции
+    virtual char operation() const = 0;
+    virtual const BasicExpression* operand(int) const { return nullptr; }
+    // Место операнда для обходов, которые заменяют операнды (simplify, specify)
+    virtual std::unique_ptr<BasicExpression>* operand_slot(int) { return nullptr; }
+    // Забирает владение операндами, оставляя узел без детей (для нерекурсивного разрушения)
+    virtual void detach(std::vector<std::unique_ptr<BasicExpression>> &) {}
+
+    // Узлы берут память из активного ExpressionArena потока, если он есть, иначе из кучи
+    static void* operator new(size_t);
+    static void operator delete(void *);
+
     // -1: нет переменных | 0: есть переменные | 1: (0 - epxr) (пока не сделал)
-    virtual std::pair<std::unique_ptr<Expression>, int> simplify() = 0;
+    virtual std::pair<std::unique_ptr<BasicExpression>, int> simplify() = 0;
+    // Шаг simplify для одного узла, операнды которого уже упрощены; types — то, что вернул их simplify
+    virtual std::pair<std::unique_ptr<BasicExpression>, int> simplify_node(const int *types) { return simplify(); }
 };
 
-class Constant : public Expression {
-    T value;
+template <typename N>
+class BasicConstant : public BasicExpression<N> {
+    using Expression = BasicExpression<N>;
+    N value;
 public:
-    Constant(T);
+    BasicConstant(N);
     std::unique_ptr<Expression> clone() const override;
+    N get_value() const;
 
-    T evaluate(const std::map<std::string, T>& = {}) const override;
+    N evaluate(const std::map<std::string, N>& = {}) const override;
     std::unique_ptr<Expression> differentiate(std::string x) const override;
-    std::unique_ptr<Expression> specify(std::string, T) override;
+    std::unique_ptr<Expression> specify(std::string, N) override;
     std::string to_string() const override;
+    char operation() const override;
     std::pair<std::unique_ptr<Expression>, int> simplify() override;
 };
 
-class Variable : public Expression {
+template <typename N>
+class BasicVariable : public BasicExpression<N> {
+    using Expression = BasicExpression<N>;
     std::string name;
 public:
-    Variable(std::string);
+    BasicVariable(std::string);
     std::unique_ptr<Expression> clone() const override;
+    const std::string& get_name() const;
 
-    T evaluate(const std::map<std::string, T>& = {}) const override;
+    N evaluate(const std::map<std::string, N>& = {}) const override;
     std::unique_ptr<Expression> differentiate(std::string x) const override;
-    std::unique_ptr<Expression> specify(std::string, T) override;
+    std::unique_ptr<Expression> specify(std::string, N) override;
     std::string to_string() const override;
+    char operation() const override;
     std::pair<std::unique_ptr<Expression>, int> simplify() override;
 };
 
-class Binary : public Expression {
+template <typename N>
+class BasicBinary : public BasicExpression<N> {
+    using Expression = BasicExpression<N>;
     char op;
     std::unique_ptr<Expression> left, right;
 public:
-    Binary(char, std::unique_ptr<Expression>, std::unique_ptr<Expression>);
-    Binary(const Binary &);
-    Binary& operator=(const Binary &);
+    BasicBinary(char, std::unique_ptr<Expression>, std::unique_ptr<Expression>);
+    BasicBinary(const BasicBinary &);
+    BasicBinary& operator=(const BasicBinary &);
+    ~BasicBinary() override;
     std::unique_ptr<Expression> clone() const override;
 
-    T evaluate(const std::map<std::string, T>& = {}) const override;
+    N evaluate(const std::map<std::string, N>& = {}) const override;
     std::unique_ptr<Expression> differentiate(std::string x) const override;
-    std::unique_ptr<Expression> specify(std::string, T) override;
+    std::unique_ptr<Expression> specify(std::string, N) override;
     std::string to_string() const override;
+    char operation() const override;
+    const Expression* operand(int) const override;
+    std::unique_ptr<Expression>* operand_slot(int) override;
+    void detach(std::vector<std::unique_ptr<Expression>> &) override;
     std::pair<std::unique_ptr<Expression>, int> simplify() override;
+    std::pair<std::unique_ptr<Expression>, int> simplify_node(const int *) override;
 };
 
-class Unary : public Expression {
+template <typename N>
+class BasicUnary : public BasicExpression<N> {
+    using Expression = BasicExpression<N>;
     char op;
     std::unique_ptr<Expression> expr;
 public:
-    Unary(char, std::unique_ptr<Expression>);
-    Unary(const Unary &);
-    Unary& operator=(const Unary &);
+    BasicUnary(char, std::unique_ptr<Expression>);
+    BasicUnary(const BasicUnary &);
+    BasicUnary& operator=(const BasicUnary &);
+    ~BasicUnary() override;
     std::unique_ptr<Expression> clone() const override;
 
-    T evaluate(const std::map<std::string, T>& = {}) const override;
+    N evaluate(const std::map<std::string, N>& = {}) const override;
     std::unique_ptr<Expression> differentiate(std::string x) const override;
-    std::unique_ptr<Expression> specify(std::string, T) override;
+    std::unique_ptr<Expression> specify(std::string, N) override;
     std::string to_string() const override;
+    char operation() const override;
+    const Expression* operand(int) const override;
+    std::unique_ptr<Expression>* operand_slot(int) override;
+    void detach(std::vector<std::unique_ptr<Expression>> &) override;
     std::pair<std::unique_ptr<Expression>, int> simplify() override;
+    std::pair<std::unique_ptr<Expression>, int> simplify_node(const int *) override;
 };
 
-bool is_number(std::string);
-bool is_name(std::string);
+#define DIFFERENTIATOR_EXTERN_TEMPLATES(N) \
+    extern template class BasicExpression<N>; \
+    extern template class BasicConstant<N>; \
+    extern template class BasicVariable<N>; \
+    extern template class BasicBinary<N>; \
+    extern template class BasicUnary<N>;
+DIFFERENTIATOR_EXTERN_TEMPLATES(float)
+DIFFERENTIATOR_EXTERN_TEMPLATES(double)
+DIFFERENTIATOR_EXTERN_TEMPLATES(long double)
+DIFFERENTIATOR_EXTERN_TEMPLATES(std::complex<double>)
+#undef DIFFERENTIATOR_EXTERN_TEMPLATES
+
+using Expression = BasicExpression<T>;
+using Constant = BasicConstant<T>;
+using Variable = BasicVariable<T>;
+using Binary = BasicBinary<T>;
+using Unary = BasicUnary<T>;
+
+// Применение операций — общее для дерева и скомпилированной программы, чтобы результаты совпадали
+template <typename N>
+N apply_unary(char op, N x) {
+    switch (op) {
+        case 's': return sin(x);
+        case 'c': return cos(x);
+        case 'l': return log(x);
+        case 'e': return exp(x);
+        default: throw std::runtime_error(std::string("Unknown operator: ") + op);
+    }
+}
+template <typename N>
+N apply_binary(char op, N l, N r) {
+    switch (op) {
+        case '+': return l + r;
+        case '-': return l - r;
+        case '*': return l * r;
+        case '/': return l / r;
+        case '^': return pow(l, r);
+        default: throw std::runtime_error(std::string("Unknown operator: ") + op);
+    }
+}
+
+bool is_number(std::string_view);
+bool is_name(std::string_view);
 template <typename L>
-L to_number(std::string source) {
+constexpr L to_number(std::string_view source) {
     bool im = (source.back() == 'i');
-    if (im) source.pop_back();
+    if (im) source.remove_suffix(1);
+    // до 19 значащих цифр число собирается в целое и делится на 10^k один раз — результат округлён верно,
+    // и напечатанная с нужной точностью константа читается обратно в то же число
+    uint64_t mantissa = 0;
+    int digits = 0, decimals = 0;
+    bool fraction = false;
+    for (char c : source) {
+        if (c == '.' || c == ',') {
+            fraction = true;
+        } else {
+            if (mantissa != 0 || c != '0') {
+                ++digits;
+                mantissa = mantissa * 10 + (c - '0');
+            }
+            if (fraction) ++decimals;
+        }
+        if (digits > 19) break;
+    }
+    if (digits <= 19 && decimals <= 27) {
+        long double scale = 1;
+        for (int k = 0; k < decimals; ++k) scale *= 10;
+        long double res = (long double)mantissa / scale;
+        if constexpr (is_complex_v<L>) {
+            if (im) return L(0, res);
+        }
+        return L(res);
+    }
     long double int_part = 0;
     int i = 0;
     for (; i < source.length() && source[i] != '.' && source[i] != ','; ++i) {
@@ -104,15 +228,23 @@ L to_number(std::string source) {
         frac_part /= 10;
     }
     long double res = int_part + frac_part;
-    if constexpr (std::is_same_v<T, std::complex<long double>>) {
-        if (im) return std::complex<long double>(0, res);
+    if constexpr (is_complex_v<L>) {
+        if (im) return L(0, res);
     }
     return L(res);
 }
 
-void simplify(std::unique_ptr<Expression> &);
+template <typename N>
+void simplify(std::unique_ptr<BasicExpression<N>> &);
+// Новое выражение, в котором переменные из bindings заменены их значениями, а всё, что от остальных
+// переменных не зависит, уже вычислено; для многократного вычисления по оставшимся переменным
+template <typename N>
+std::unique_ptr<BasicExpression<N>> specialize(const BasicExpression<N> &, const std::map<std::string, N> &);
+template <typename N>
+size_t count_nodes(const BasicExpression<N> &);
+template <typename N>
+size_t tree_depth(const BasicExpression<N> &);
 size_t find_close(std::string);
-size_t find_operator(std::string);
 std::string delete_zeros(std::string);
 
 namespace std {
@@ -0,0 +1,60 @@
+#include "Gradient.hpp"
+
+#include <algorithm>
+
+T gradient(const Program &program, const T *slots, T *partials) {
+    const std::vector<Instruction> &code = program.code;
+    thread_local std::vector<T> values, adjoints;
+    if (values.size() < code.size()) {
+        values.resize(code.size());
+        adjoints.resize(code.size());
+    }
+    T result = program.run(slots, values.data());
+    std::fill(adjoints.begin(), adjoints.begin() + code.size(), T(0));
+    std::fill(partials, partials + program.variables.size(), T(0));
+    adjoints[code.size() - 1] = 1;
+
+    for (size_t i = code.size(); i-- > 0;) {
+        const Instruction &ins = code[i];
+        T g = adjoints[i];
+        if (g == T(0)) continue;
+        T a = (arity(ins.op) >= 1 ? values[ins.a] : T(0));
+        T b = (arity(ins.op) == 2 ? values[ins.b] : T(0));
+        switch (ins.op) {
+            case 'n': break;
+            case 'v': partials[ins.a] += g; break;
+            case 's': adjoints[ins.a] += g * cos(a); break;
+            case 'c': adjoints[ins.a] -= g * sin(a); break;
+            case 'l': adjoints[ins.a] += g / a; break;
+            case 'e': adjoints[ins.a] += g * values[i]; break;
+            case '+': adjoints[ins.a] += g; adjoints[ins.b] += g; break;
+            case '-': adjoints[ins.a] += g; adjoints[ins.b] -= g; break;
+            case '*': adjoints[ins.a] += g * b; adjoints[ins.b] += g * a; break;
+            case '/': adjoints[ins.a] += g / b; adjoints[ins.b] -= g * a / (b * b); break;
+            case '^':
+                // та же формула, что у символьной производной exp(b * ln(a))
+                adjoints[ins.a] += g * values[i] * b / a;
+                if (code[ins.b].op != 'n') adjoints[ins.b] += g * values[i] * log(a);
+                break;
+            default: throw std::runtime_error(std::string("Unknown operator: ") + ins.op);
+        }
+    }
+    return result;
+}
+
+std::pair<T, std::vector<T>> gradient(const Expression &expr, const std::vector<std::string> &vars,
+                                      const std::map<std::string, T> &point) {
+    Program program = compile(expr);
+    std::vector<T> slots(program.variables.size()), partials(program.variables.size());
+    for (size_t i = 0; i < slots.size(); ++i) {
+        auto it = point.find(program.variables[i]);
+        slots[i] = (it != point.end()) ? it->second : T{};
+    }
+    T value = gradient(program, slots.data(), partials.data());
+    std::vector<T> result(vars.size());
+    for (size_t i = 0; i < vars.size(); ++i) {
+        size_t slot = program.slot(vars[i]);
+        result[i] = (slot < partials.size() ? partials[slot] : T(0));
+    }
+    return {value, result};
+}
@@ -0,0 +1,17 @@
+#ifndef GRADIENT_HPP
+#define GRADIENT_HPP
+
+#include "Bytecode.hpp"
+
+#include <vector>
+
+// Обратный режим автоматического дифференцирования: один прямой проход по программе
+// и один обратный проход сопряжённых значений дают значение и все частные производные
+// за время порядка одного вычисления. partials[slot] — производная по program.variables[slot].
+T gradient(const Program &, const T *slots, T *partials);
+
+// Значение и производные по vars (в том же порядке) в точке point
+std::pair<T, std::vector<T>> gradient(const Expression &, const std::vector<std::string> &vars,
+                                      const std::map<std::string, T> &point);
+
+#endif
@@ -0,0 +1,94 @@
+#include "Incremental.hpp"
+#include "Dag.hpp"
+
+#include <algorithm>
+#include <functional>
+
+IncrementalContext::IncrementalContext(const Expression &expr)
+    : IncrementalContext([&]() {
+          NodeStore store;
+          return store.compile(store.insert(expr));
+      }()) {}
+
+IncrementalContext::IncrementalContext(Program program) : code(std::move(program)) {
+    slots.assign(code.variables.size(), T{});
+    registers.assign(code.size(), T{});
+    users.resize(code.size());
+    readers.resize(code.variables.size());
+    queued.assign(code.size(), false);
+    for (uint32_t i = 0; i < code.size(); ++i) {
+        const Instruction &ins = code.code[i];
+        int n = arity(ins.op);
+        if (ins.op == 'v') readers[ins.a].push_back(i);
+        if (n >= 1) users[ins.a].push_back(i);
+        if (n == 2 && ins.b != ins.a) users[ins.b].push_back(i);
+    }
+    code.run(slots.data(), registers.data());
+    stats.recomputed += code.size();
+}
+
+void IncrementalContext::set(std::string_view name, T val) {
+    size_t slot = code.slot(name);
+    if (slot < slots.size()) set(slot, val);
+}
+void IncrementalContext::set(size_t slot, T val) {
+    if (slots[slot] == val) return;
+    slots[slot] = val;
+    for (uint32_t i : readers[slot]) mark(i);
+}
+T IncrementalContext::get(std::string_view name) const {
+    size_t slot = code.slot(name);
+    return slot < slots.size() ? slots[slot] : T{};
+}
+
+// Грязные инструкции лежат в куче по номеру: номер инструкции больше номеров её операндов,
+// поэтому к моменту пересчёта все её грязные операнды уже пересчитаны
+void IncrementalContext::mark(uint32_t i) {
+    if (queued[i]) return;
+    queued[i] = true;
+    dirty.push_back(i);
+    std::push_heap(dirty.begin(), dirty.end(), std::greater<>());
+}
+
+bool IncrementalContext::execute(uint32_t i) {
+    const Instruction &ins = code.code[i];
+    T result;
+    switch (ins.op) {
+        case 'n': result = code.constants[ins.a]; break;
+        case 'v': result = slots[ins.a]; break;
+        case 's': case 'c': case 'l': case 'e':
+            result = apply_unary(ins.op, registers[ins.a]); break;
+        default:
+            result = apply_binary(ins.op, registers[ins.a], registers[ins.b]);
+    }
+    bool changed = !(result == registers[i]);
+    registers[i] = result;
+    return changed;
+}
+
+T IncrementalContext::value() {
+    ++stats.evaluations;
+    while (!dirty.empty()) {
+        std::pop_heap(dirty.begin(), dirty.end(), std::greater<>());
+        uint32_t i = dirty.back();
+        dirty.pop_back();
+        queued[i] = false;
+        ++stats.recomputed;
+        if (execute(i)) {
+            for (uint32_t user : users[i]) mark(user);
+        } else {
+            ++stats.unchanged;
+        }
+    }
+    return registers.back();
+}
+
+const Program& IncrementalContext::program() const {
+    return code;
+}
+const IncrementalContext::Counters& IncrementalContext::counters() const {
+    return stats;
+}
+void IncrementalContext::reset_counters() {
+    stats = {};
+}
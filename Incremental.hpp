@@ -0,0 +1,47 @@
+#ifndef INCREMENTAL_HPP
+#define INCREMENTAL_HPP
+
+#include "Bytecode.hpp"
+
+#include <vector>
+
+// Контекст инкрементального вычисления: значения всех узлов программы хранятся между вызовами,
+// а set() помечает грязными только инструкции, читающие изменённую переменную. value() пересчитывает
+// грязный подграф в порядке программы; если значение инструкции не изменилось, её потребители
+// не пересчитываются. Выражение компилируется через NodeStore, так что общие подвыражения —
+// одна инструкция. Результат совпадает с Program::evaluate бит в бит.
+class IncrementalContext {
+public:
+    struct Counters {
+        size_t evaluations = 0;  // вызовы value()
+        size_t recomputed = 0;   // выполненные инструкции
+        size_t unchanged = 0;    // из них дали прежнее значение (дальше пересчёт не пошёл)
+    };
+
+    explicit IncrementalContext(const Expression &);
+    explicit IncrementalContext(Program);
+
+    // переменная, которой нет в выражении, не влияет на результат и пропускается
+    void set(std::string_view, T);
+    void set(size_t slot, T);
+    T get(std::string_view) const;
+    T value();
+
+    const Program& program() const;
+    const Counters& counters() const;
+    void reset_counters();
+
+private:
+    Program code;
+    std::vector<T> slots, registers;
+    // users[i] — инструкции, читающие регистр i; readers[slot] — инструкции 'v' этого слота
+    std::vector<std::vector<uint32_t>> users, readers;
+    std::vector<uint32_t> dirty;
+    std::vector<bool> queued;
+    Counters stats;
+
+    void mark(uint32_t);
+    bool execute(uint32_t);
+};
+
+#endif
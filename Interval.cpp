@@ -0,0 +1,317 @@
+#include "Interval.hpp"
+#include "Polynomial.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+constexpr T INF = std::numeric_limits<T>::infinity();
+constexpr T PI = 3.141592653589793238462643383279502884L;
+
+
+//--------------//
+//---INTERVAL---//
+//--------------//
+Interval::Interval(T value) : lo(value), hi(value) {
+    if (std::isnan(value)) *this = empty();
+}
+Interval::Interval(T lo, T hi, bool partial) : lo(lo), hi(hi), partial(partial) {}
+Interval Interval::empty() {
+    return Interval(INF, -INF, true);
+}
+bool Interval::is_empty() const {
+    return !(lo <= hi);
+}
+bool Interval::contains(T x) const {
+    return lo <= x && x <= hi;
+}
+T Interval::width() const {
+    return is_empty() ? 0 : hi - lo;
+}
+
+static T down(T x, int ulps) {
+    for (int i = 0; i < ulps; ++i) x = std::nextafter(x, -INF);
+    return x;
+}
+static T up(T x, int ulps) {
+    for (int i = 0; i < ulps; ++i) x = std::nextafter(x, INF);
+    return x;
+}
+// Границы, посчитанные с округлением к ближайшему, отодвигаются наружу на ulps.
+// NaN в границе (inf - inf) — неопределённость: граница становится бесконечной
+static Interval outward(T lo, T hi, bool partial, int ulps = 1) {
+    bool undefined = std::isnan(lo) || std::isnan(hi);
+    if (std::isnan(lo)) lo = -INF;
+    if (std::isnan(hi)) hi = INF;
+    return Interval(down(lo, ulps), up(hi, ulps), partial || undefined);
+}
+// Произведение границ: 0 * inf = 0, потому что бесконечная граница — неограниченность, а не значение
+static T product(T x, T y) {
+    return (x == 0 || y == 0) ? T(0) : x * y;
+}
+// Точный ли результат операции над двумя точками: тогда он остаётся точкой, и постоянные
+// подвыражения вроде показателя 0 - 2 (так разбирается x ^ -2) не расширяются.
+// Остаток произведения и частного проверяется через fma вдали от денормалов, где он сам представим
+constexpr T EXACT_MIN = 1e-4000L;
+static bool exact_sum(T a, T b, T s) {
+    T bb = s - a;
+    return (a - (s - bb)) + (b - bb) == 0;
+}
+static bool exact_product(T a, T b, T p) {
+    if (a == 0 || b == 0) return p == 0;
+    return std::fabs(p) > EXACT_MIN && std::fma(a, b, -p) == 0;
+}
+static bool exact_quotient(T a, T b, T q) {
+    if (a == 0) return b != 0 && q == 0;
+    return std::fabs(q) > EXACT_MIN && std::fabs(a) > EXACT_MIN && std::fma(q, b, -a) == 0;
+}
+static bool is_point(const Interval &a) {
+    return a.lo == a.hi;
+}
+
+
+//----------------//
+//---ARITHMETIC---//
+//----------------//
+Interval operator+(const Interval &a, const Interval &b) {
+    if (a.is_empty() || b.is_empty()) return Interval::empty();
+    bool partial = a.partial || b.partial;
+    if (is_point(a) && is_point(b) && exact_sum(a.lo, b.lo, a.lo + b.lo))
+        return Interval(a.lo + b.lo, a.lo + b.lo, partial);
+    return outward(a.lo + b.lo, a.hi + b.hi, partial);
+}
+Interval operator-(const Interval &a, const Interval &b) {
+    if (a.is_empty() || b.is_empty()) return Interval::empty();
+    bool partial = a.partial || b.partial;
+    if (is_point(a) && is_point(b) && exact_sum(a.lo, -b.lo, a.lo - b.lo))
+        return Interval(a.lo - b.lo, a.lo - b.lo, partial);
+    return outward(a.lo - b.hi, a.hi - b.lo, partial);
+}
+Interval operator*(const Interval &a, const Interval &b) {
+    if (a.is_empty() || b.is_empty()) return Interval::empty();
+    bool partial = a.partial || b.partial;
+    if (is_point(a) && is_point(b) && exact_product(a.lo, b.lo, a.lo * b.lo))
+        return Interval(a.lo * b.lo, a.lo * b.lo, partial);
+    T p[4] = {product(a.lo, b.lo), product(a.lo, b.hi), product(a.hi, b.lo), product(a.hi, b.hi)};
+    return outward(*std::min_element(p, p + 4), *std::max_element(p, p + 4), partial);
+}
+// Делитель с нулём внутри или ровно 0 — вся прямая (знак нуля отрезок не хранит, а x / 0 в дереве — это
+// +-inf); с нулём на краю — полупрямая через 1 / b. Сама точка 0 делителя — вне области: partial
+Interval operator/(const Interval &a, const Interval &b) {
+    if (a.is_empty() || b.is_empty()) return Interval::empty();
+    bool partial = a.partial || b.partial;
+    if (b.lo > 0 || b.hi < 0) {
+        if (is_point(a) && is_point(b) && exact_quotient(a.lo, b.lo, a.lo / b.lo))
+            return Interval(a.lo / b.lo, a.lo / b.lo, partial);
+        T q[4] = {a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi};
+        return outward(*std::min_element(q, q + 4), *std::max_element(q, q + 4), partial);
+    }
+    if (a.lo == 0 && a.hi == 0) return Interval(0, 0, true);
+    if (b.lo == b.hi || (b.lo < 0 && b.hi > 0)) return Interval(-INF, INF, true);
+    Interval reciprocal = (b.lo == 0) ? outward(1 / b.hi, INF, true) : outward(-INF, 1 / b.lo, true);
+    return a * reciprocal;
+}
+
+
+//---------------//
+//---FUNCTIONS---//
+//---------------//
+// Концы отрезка, округлённые наружу до double: по ним считаются функции libm
+static double below(T x) {
+    double d = double(x);
+    return (d > x) ? std::nextafter(d, -HUGE_VAL) : d;
+}
+static double above(T x) {
+    double d = double(x);
+    return (d < x) ? std::nextafter(d, HUGE_VAL) : d;
+}
+// Значения функций libm над double отодвигаются наружу на INTERVAL_LIBM_ULPS ulp double
+static Interval libm(double lo, double hi, bool partial) {
+    bool undefined = std::isnan(lo) || std::isnan(hi);
+    if (std::isnan(lo)) lo = -HUGE_VAL;
+    if (std::isnan(hi)) hi = HUGE_VAL;
+    for (int i = 0; i < INTERVAL_LIBM_ULPS; ++i) {
+        lo = std::nextafter(lo, -HUGE_VAL);
+        hi = std::nextafter(hi, HUGE_VAL);
+    }
+    return Interval(lo, hi, partial || undefined);
+}
+
+Interval exp(const Interval &a) {
+    if (a.is_empty()) return a;
+    Interval r = libm(std::exp(below(a.lo)), std::exp(above(a.hi)), a.partial);
+    r.lo = std::max(r.lo, T(0));
+    return r;
+}
+Interval log(const Interval &a) {
+    if (a.is_empty() || a.hi < 0) return Interval::empty();
+    double lo = (a.lo <= 0) ? -HUGE_VAL : std::log(below(a.lo));
+    return libm(lo, std::log(above(a.hi)), a.partial || a.lo < 0);
+}
+
+// Есть ли точка offset + 2 pi k в [lo, hi]. При сомнении из-за округления — есть: лишний экстремум
+// только расширяет оценку
+static bool has_point(T lo, T hi, T offset) {
+    T slack = 64 * std::numeric_limits<T>::epsilon() * (std::fabs(lo) + std::fabs(hi) + 1);
+    T k = std::ceil((lo - slack - offset) / (2 * PI));
+    return offset + k * 2 * PI <= hi + slack;
+}
+// Значения на концах и экстремумы внутри: максимум в max_at + 2 pi k, минимум в max_at + pi + 2 pi k
+static Interval periodic(const Interval &a, double (*f)(double), T max_at) {
+    if (a.is_empty()) return a;
+    double lo = below(a.lo), hi = above(a.hi);
+    if (!(T(hi) - T(lo) < 2 * PI)) return Interval(-1, 1, a.partial);
+    double x = f(lo), y = f(hi);
+    Interval r = libm(std::min(x, y), std::max(x, y), a.partial);
+    if (has_point(lo, hi, max_at)) r.hi = 1;
+    if (has_point(lo, hi, max_at + PI)) r.lo = -1;
+    r.lo = std::max(r.lo, T(-1));
+    r.hi = std::min(r.hi, T(1));
+    return r;
+}
+Interval sin(const Interval &a) {
+    return periodic(a, [](double x) { return std::sin(x); }, PI / 2);
+}
+Interval cos(const Interval &a) {
+    return periodic(a, [](double x) { return std::cos(x); }, 0);
+}
+
+// x ^ y на [xlo, xhi] x y при xlo >= 0: по каждому аргументу при фиксированном другом
+// степень монотонна, поэтому экстремумы — в углах
+// Знак нуля отрезок не хранит: углы считаются от +0, а -0 (0 / -3 в дереве) при отрицательном
+// нечётном y даёт -inf, который добавляется отдельно
+static Interval corners(T xlo, T xhi, const Interval &y, bool partial) {
+    double x0 = below(xlo), x1 = above(xhi), y0 = below(y.lo), y1 = above(y.hi);
+    if (x0 == 0) x0 = 0;
+    if (x1 == 0) x1 = 0;
+    double p[4] = {std::pow(x0, y0), std::pow(x0, y1), std::pow(x1, y0), std::pow(x1, y1)};
+    Interval r = libm(*std::min_element(p, p + 4), *std::max_element(p, p + 4), partial);
+    r.lo = std::max(r.lo, T(0));
+    T odd = std::ceil(y.lo);
+    if (std::fmod(odd, T(2)) == 0) odd += 1;
+    if (x0 == 0 && odd <= std::min(y.hi, T(-1))) r.lo = -INF;
+    return r;
+}
+// Целый показатель n > 0: нечётная степень монотонна, чётная — с минимумом 0, если отрезок его содержит
+static Interval integer_power(const Interval &a, double n, bool partial) {
+    double x = std::pow(below(a.lo), n), y = std::pow(above(a.hi), n);
+    if (std::fmod(n, 2.0) != 0 || a.lo >= 0) return libm(x, y, partial);
+    if (a.hi <= 0) return libm(y, x, partial);
+    Interval r = libm(0, std::max(x, y), partial);
+    r.lo = 0;
+    return r;
+}
+// Постоянный целый показатель — как у pow в точке, в том числе для отрицательного основания.
+// Иначе отрицательное основание определено только при целых y: оценка по модулю, симметричная, и partial
+// pow(x, 0) = 1 и pow(1, y) = 1 при любых x и y, даже NaN, — так считает и дерево
+Interval pow(const Interval &a, const Interval &b) {
+    if (b.lo == 0 && b.hi == 0) return Interval(1, 1, b.partial);
+    if (a.lo == 1 && a.hi == 1) return Interval(1, 1, a.partial);
+    if (b.is_empty()) return a.contains(1) ? Interval(1, 1, true) : Interval::empty();
+    if (a.is_empty()) return b.contains(0) ? Interval(1, 1, true) : Interval::empty();
+    bool partial = a.partial || b.partial;
+    if (is_point(b) && b.lo == std::floor(b.lo) && below(b.lo) == above(b.lo)) {
+        if (b.lo > 0) return integer_power(a, double(b.lo), partial);
+        return Interval(1) / integer_power(a, double(-b.lo), partial);
+    }
+    if (a.lo >= 0) return corners(a.lo, a.hi, b, partial);
+    if (std::floor(b.hi) >= std::ceil(b.lo)) {
+        Interval r = corners(0, std::max(-a.lo, a.hi), b, true);
+        return Interval(-r.hi, r.hi, true);
+    }
+    Interval r = (a.hi < 0) ? Interval::empty() : corners(0, a.hi, b, true);
+    // pow(-inf, y) при нецелом y определён: 0 или +inf
+    if (a.lo == -INF) r = Interval(std::min(r.lo, T(0)), INF, true);
+    return r;
+}
+
+
+//-----------//
+//---BOUND---//
+//-----------//
+// Буфер регистров свой у каждого потока, как в Program::evaluate
+static Interval run(const Program &program, const Interval *slots) {
+    thread_local std::vector<Interval> registers;
+    if (registers.size() < program.size())
+        registers.resize(program.size());
+    return program.run(slots, registers.data());
+}
+
+Interval bound(const Expression &expr, const std::map<std::string, Interval> &box) {
+    Program program = compile(expr);
+    std::vector<Interval> slots(program.variables.size());
+    for (size_t i = 0; i < slots.size(); ++i) {
+        auto it = box.find(program.variables[i]);
+        if (it != box.end()) slots[i] = it->second;
+    }
+    return run(program, slots.data());
+}
+
+RangeBound::RangeBound(const Expression &expr) : function(compile(expr)) {
+    for (const std::string &x : function.variables) {
+        // без simplify: его тождества (0 / 0 = 0, x / x = 1) стирают точки, где производной нет
+        std::unique_ptr<Expression> derivative = horner_derivative(expr, x);
+        derivatives.push_back(compile(*derivative));
+        std::vector<uint32_t> map;
+        for (const std::string &name : derivatives.back().variables)
+            map.push_back(function.slot(name));
+        slots.push_back(std::move(map));
+    }
+}
+
+const std::vector<std::string>& RangeBound::variables() const {
+    return function.variables;
+}
+
+Interval RangeBound::naive(const Interval *box) const {
+    return run(function, box);
+}
+
+void RangeBound::monotonicity(const Interval *box, int *signs) const {
+    thread_local std::vector<Interval> values;
+    for (size_t i = 0; i < derivatives.size(); ++i) {
+        signs[i] = 0;
+        // точка: грани совпадают, и производную считать незачем
+        if (box[i].lo == box[i].hi) continue;
+        values.resize(slots[i].size());
+        for (size_t k = 0; k < slots[i].size(); ++k)
+            values[k] = box[slots[i][k]];
+        Interval d = run(derivatives[i], values.data());
+        // бесконечная граница — производная не ограничена (0 ^ x, ln(0)), и скачок функции возможен
+        if (d.partial || d.is_empty() || !std::isfinite(d.lo) || !std::isfinite(d.hi)) continue;
+        if (d.lo >= 0) signs[i] = 1;
+        else if (d.hi <= 0) signs[i] = -1;
+    }
+}
+
+// Монотонность по x_i на всей рамке позволяет двигать x_i к грани независимо от остальных
+// переменных, поэтому все монотонные переменные заменяются гранями одновременно
+Interval RangeBound::bound(const Interval *box) const {
+    Interval result = naive(box);
+    if (result.partial || result.is_empty()) return result;
+    size_t n = function.variables.size();
+    thread_local std::vector<int> signs;
+    thread_local std::vector<Interval> low, high;
+    signs.resize(n);
+    monotonicity(box, signs.data());
+    if (std::none_of(signs.begin(), signs.end(), [](int s) { return s != 0; })) return result;
+    low.assign(box, box + n);
+    high.assign(box, box + n);
+    for (size_t i = 0; i < n; ++i) {
+        if (signs[i] == 0) continue;
+        low[i] = Interval(signs[i] > 0 ? box[i].lo : box[i].hi);
+        high[i] = Interval(signs[i] > 0 ? box[i].hi : box[i].lo);
+    }
+    result.lo = std::max(result.lo, run(function, low.data()).lo);
+    result.hi = std::min(result.hi, run(function, high.data()).hi);
+    return result;
+}
+
+void RangeBound::bound_batch(const Interval *const *columns, size_t rows, Interval *out, bool monotone) const {
+    std::vector<Interval> box(function.variables.size());
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t i = 0; i < box.size(); ++i)
+            box[i] = columns[i][row];
+        out[row] = monotone ? bound(box.data()) : naive(box.data());
+    }
+}
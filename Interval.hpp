@@ -0,0 +1,73 @@
+#ifndef INTERVAL_HPP
+#define INTERVAL_HPP
+
+#include "Bytecode.hpp"
+
+#include <vector>
+
+// Запас в ulp double для sin, cos, ln, exp и pow из libm (их ошибка — меньше 1 ulp)
+constexpr int INTERVAL_LIBM_ULPS = 4;
+
+// Отрезок [lo, hi], содержащий все значения выражения в точках рамки, где оно определено.
+// Границы округляются наружу: после + - * / на 1 ulp long double, а точный результат операции над двумя
+// точками остаётся точкой (постоянный показатель 0 - 2 — целое -2). Функции дерево вычисляет, как и
+// apply_unary / apply_binary, через libm над double, поэтому для sin, cos, ln, exp и pow концы сначала
+// округляются наружу до double, а результат расширяется на INTERVAL_LIBM_ULPS ulp double: отрезок
+// содержит и точные значения, и то, что вернёт evaluate() в точках рамки.
+// partial — в рамке есть точки вне области определения (ln от отрицательного, деление на отрезок с нулём,
+// степень отрицательного с нецелым показателем); пустой отрезок (lo > hi) — выражение не определено нигде.
+// Константа — вырожденный отрезок, поэтому прогон Program::run<Interval> даёт оценку по всей программе.
+class Interval {
+public:
+    T lo, hi;
+    bool partial = false;
+
+    Interval(T = 0);
+    Interval(T lo, T hi, bool partial = false);
+    static Interval empty();
+
+    bool is_empty() const;
+    bool contains(T) const;
+    T width() const;
+};
+
+Interval operator+(const Interval &, const Interval &);
+Interval operator-(const Interval &, const Interval &);
+Interval operator*(const Interval &, const Interval &);
+Interval operator/(const Interval &, const Interval &);
+Interval pow(const Interval &, const Interval &);
+Interval sin(const Interval &);
+Interval cos(const Interval &);
+Interval log(const Interval &);
+Interval exp(const Interval &);
+
+// Оценка выражения на рамке box; переменные, которых нет в box, равны 0, как в Program::evaluate
+Interval bound(const Expression &, const std::map<std::string, Interval> &box);
+
+// Оценка с проверкой монотонности. Вместе с выражением компилируются его частные производные
+// (horner_derivative: x ^ c дифференцируется как c * x ^ (c - 1), без ln, так что знак производной
+// оценивается и при отрицательных x). Если производная по x_i на рамке не меняет знак, минимум и максимум
+// достигаются на гранях x_i = lo и x_i = hi: переменная заменяется точкой, и отрезок сужается.
+// Рамка — интервалы переменных в порядке variables().
+class RangeBound {
+public:
+    explicit RangeBound(const Expression &);
+    const std::vector<std::string>& variables() const;
+
+    // Оценка одним прогоном, без производных
+    Interval naive(const Interval *box) const;
+    // signs[i]: 1 — выражение не убывает по x_i на всей рамке, -1 — не возрастает, 0 — неизвестно
+    void monotonicity(const Interval *box, int *signs) const;
+    // Пересечение простой оценки и оценки по граням монотонных переменных
+    Interval bound(const Interval *box) const;
+    // Сразу для rows рамок: columns[i] — непрерывный массив интервалов переменной variables()[i]
+    void bound_batch(const Interval *const *columns, size_t rows, Interval *out, bool monotone = true) const;
+
+private:
+    Program function;
+    std::vector<Program> derivatives;
+    // slots[i][k] — номер переменной k-го слота производной по x_i среди variables()
+    std::vector<std::vector<uint32_t>> slots;
+};
+
+#endif
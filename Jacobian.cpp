@@ -0,0 +1,59 @@
+#include "Jacobian.hpp"
+
+std::unique_ptr<Expression> DerivativeSet::expression(NodeStore::Id id) const {
+    return store.extract(id);
+}
+
+namespace {
+// Элемент, посчитанный потоком worker: id — в его хранилище
+struct Computed {
+    size_t worker;
+    NodeStore::Id derivative;
+    std::vector<NodeStore::Id> second;  // по x_k, k >= j
+};
+}
+
+DerivativeSet jacobian(const std::vector<const Expression *> &functions, const std::vector<std::string> &variables,
+                       Executor &executor, bool hessian) {
+    size_t E = functions.size(), V = variables.size();
+    std::vector<NodeStore> stores(executor.size());
+    // выражение вставляется в хранилище потока при первой встрече
+    std::vector<std::vector<NodeStore::Id>> inserted(executor.size(), std::vector<NodeStore::Id>(E));
+    std::vector<std::vector<bool>> present(executor.size(), std::vector<bool>(E, false));
+    std::vector<Computed> computed(E * V);
+
+    executor.parallel_for(E * V, 1, [&](size_t worker, size_t begin, size_t end) {
+        NodeStore &store = stores[worker];
+        for (size_t t = begin; t < end; ++t) {
+            size_t i = t / V, j = t % V;
+            if (!present[worker][i]) {
+                inserted[worker][i] = store.insert(*functions[i]);
+                present[worker][i] = true;
+            }
+            Computed &c = computed[t];
+            c.worker = worker;
+            c.derivative = store.simplify(store.differentiate(inserted[worker][i], variables[j]));
+            if (hessian)
+                for (size_t k = j; k < V; ++k)
+                    c.second.push_back(store.simplify(store.differentiate(c.derivative, variables[k])));
+        }
+    });
+
+    DerivativeSet result;
+    result.variables = variables;
+    result.jacobian.assign(E, std::vector<NodeStore::Id>(V));
+    if (hessian) result.hessian.assign(E, std::vector<std::vector<NodeStore::Id>>(V, std::vector<NodeStore::Id>(V)));
+    std::vector<std::unordered_map<NodeStore::Id, NodeStore::Id>> copied(stores.size());
+    for (size_t i = 0; i < E; ++i) {
+        result.values.push_back(result.store.insert(*functions[i]));
+        for (size_t j = 0; j < V; ++j) {
+            const Computed &c = computed[i * V + j];
+            NodeStore &from = stores[c.worker];
+            result.jacobian[i][j] = result.store.import(from, c.derivative, copied[c.worker]);
+            for (size_t k = j; k < V && hessian; ++k)
+                result.hessian[i][j][k] = result.hessian[i][k][j] =
+                    result.store.import(from, c.second[k - j], copied[c.worker]);
+        }
+    }
+    return result;
+}
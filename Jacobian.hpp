@@ -0,0 +1,28 @@
+#ifndef JACOBIAN_HPP
+#define JACOBIAN_HPP
+
+#include "Dag.hpp"
+#include "Executor.hpp"
+
+#include <vector>
+
+// Символьные производные набора выражений в одном хранилище: общие подвыражения
+// всех элементов существуют в одном экземпляре и компилируются в одну программу.
+struct DerivativeSet {
+    NodeStore store;
+    std::vector<std::string> variables;
+    std::vector<NodeStore::Id> values;                               // [i] — само выражение
+    std::vector<std::vector<NodeStore::Id>> jacobian;                // [i][j] — d f_i / d x_j
+    std::vector<std::vector<std::vector<NodeStore::Id>>> hessian;    // [i][j][k], [i][k][j] — тот же узел
+
+    std::unique_ptr<Expression> expression(NodeStore::Id) const;
+};
+
+// Якобиан (и по запросу гессианы) упрощёнными символьными производными, пары (выражение, переменная) —
+// по потокам. У каждого потока своё хранилище, так что промежуточные производные, общие для
+// нескольких элементов, считаются в нём один раз; симметричные элементы гессиана — только при j <= k.
+// Затем всё переносится в общее хранилище в фиксированном порядке: результат не зависит от числа потоков.
+DerivativeSet jacobian(const std::vector<const Expression *> &, const std::vector<std::string> &variables,
+                       Executor &, bool hessian = false);
+
+#endif
@@ -0,0 +1,255 @@
+#include "Kernels.hpp"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX__)
+constexpr size_t LANES = 4;
+#else
+constexpr size_t LANES = 2;
+#endif
+
+typedef double vdouble __attribute__((vector_size(LANES * sizeof(double))));
+typedef int64_t vlong __attribute__((vector_size(LANES * sizeof(int64_t))));
+
+// x * C + SHIFT округляет к ближайшему целому, а младшие биты результата содержат само целое
+static const double SHIFT = 0x1.8p52;
+static const double INF = HUGE_VAL;
+
+static inline vdouble load(const double *p) {
+    vdouble v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+static inline void store(double *p, vdouble v) {
+    std::memcpy(p, &v, sizeof(v));
+}
+static inline vdouble splat(double x) {
+    return vdouble{} + x;
+}
+static inline vlong round_to_long(vdouble t) {
+    return (vlong)t - (vlong)splat(SHIFT);
+}
+static inline vdouble long_to_double(vlong k) {
+    return (vdouble)(k + (vlong)splat(SHIFT)) - SHIFT;
+}
+static inline bool any(vlong mask) {
+    for (size_t i = 0; i < LANES; ++i)
+        if (mask[i]) return true;
+    return false;
+}
+
+
+//-----------//
+//----EXP----//
+//-----------//
+// exp(x) = 2^k * exp(r), |r| <= ln2 / 2, exp(r) — ряд Тейлора до r^13 (FAST — многочлен Чебышёва степени 9)
+template <bool FAST>
+static vdouble vexp(vdouble x) {
+    const double LOG2E = 1.44269504088896338700e+00;
+    const double LN2_HI = 6.93147180369123816490e-01, LN2_LO = 1.90821492927058770002e-10;
+    vdouble nan = x;
+    x = x > 710.0 ? splat(710.0) : x;
+    x = x < -746.0 ? splat(-746.0) : x;
+    vdouble t = x * LOG2E + SHIFT;
+    vdouble n = t - SHIFT;
+    vlong k = round_to_long(t);
+    vdouble r = x - n * LN2_HI;
+    r = r - n * LN2_LO;
+    vdouble p;
+    if constexpr (FAST) {
+        // схема Эстрина: четыре независимые пары вместо цепочки из девяти умножений
+        const double E0 = 1.0000000000000135, E1 = 1.0000000000000013, E2 = 0.4999999999943814,
+                     E3 = 0.16666666666615607, E4 = 0.041666667040776456, E5 = 0.008333333367332009,
+                     E6 = 0.0013888801714761622, E7 = 0.0001984119061583585, E8 = 2.488447635159146e-05,
+                     E9 = 2.763265575933203e-06;
+        vdouble r2 = r * r, r4 = r2 * r2;
+        p = (E0 + E1 * r) + r2 * (E2 + E3 * r) + r4 * ((E4 + E5 * r) + r2 * (E6 + E7 * r) + r4 * (E8 + E9 * r));
+    } else {
+        p = splat(1.0 / 6227020800.0);
+        const double coeffs[13] = {1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0, 1.0 / 362880.0,
+                                   1.0 / 40320.0, 1.0 / 5040.0, 1.0 / 720.0, 1.0 / 120.0, 1.0 / 24.0,
+                                   1.0 / 6.0, 0.5, 1.0, 1.0};
+        for (double c : coeffs)
+            p = p * r + c;
+    }
+    // 2^k двумя множителями, чтобы не переполнить порядок и получить субнормальные числа
+    vlong k1 = k >> 1, k2 = k - k1;
+    vdouble s1 = (vdouble)((k1 + 1023) << 52), s2 = (vdouble)((k2 + 1023) << 52);
+    vdouble res = p * s1 * s2;
+    return nan != nan ? nan : res;
+}
+
+
+//-----------//
+//----LOG----//
+//-----------//
+// x = m * 2^e, m в [sqrt(2)/2, sqrt(2)), ln(m) — по схеме fdlibm через s = f / (2 + f)
+// (FAST — многочлен Чебышёва степени 4 по z = s^2 вместо 6)
+template <bool FAST>
+static vdouble vlog(vdouble x) {
+    const double LN2_HI = 6.93147180369123816490e-01, LN2_LO = 1.90821492927058770002e-10;
+    const double LG1 = 6.666666666666735130e-01, LG2 = 3.999999999940941908e-01, LG3 = 2.857142874366239149e-01,
+                 LG4 = 2.222219843214978396e-01, LG5 = 1.818357216161805012e-01, LG6 = 1.531383769920937332e-01,
+                 LG7 = 1.479819860511658591e-01;
+    vlong tiny = x < DBL_MIN;
+    vdouble xs = tiny ? x * 0x1p54 : x;
+    vlong bits = (vlong)xs;
+    vlong e = ((bits >> 52) & 0x7ff) - 1023;
+    e = tiny ? e - 54 : e;
+    vdouble m = (vdouble)((bits & 0x000fffffffffffff) | 0x3ff0000000000000);
+    vlong big = m > M_SQRT2;
+    m = big ? m * 0.5 : m;
+    e = e - big;
+    vdouble f = m - 1.0;
+    vdouble s = f / (f + 2.0);
+    vdouble z = s * s;
+    vdouble w = z * z;
+    vdouble r;
+    if constexpr (FAST) {
+        const double Q0 = 0.6666666666737545, Q1 = 0.39999998796848674, Q2 = 0.2857175463573276,
+                     Q3 = 0.22191394493175057, Q4 = 0.19362776836747533;
+        r = z * (Q0 + z * Q1) + w * z * (Q2 + z * Q3 + w * Q4);
+    } else {
+        vdouble r1 = w * (LG2 + w * (LG4 + w * LG6));
+        vdouble r2 = z * (LG1 + w * (LG3 + w * (LG5 + w * LG7)));
+        r = r1 + r2;
+    }
+    vdouble hfsq = 0.5 * f * f;
+    vdouble dk = long_to_double(e);
+    vdouble res = dk * LN2_HI - ((hfsq - (s * (hfsq + r) + dk * LN2_LO)) - f);
+    res = x == 0.0 ? splat(-INF) : res;
+    res = x < 0.0 ? splat(NAN) : res;
+    res = x == INF ? splat(INF) : res;
+    return x != x ? x : res;
+}
+
+
+//-------------//
+//---SIN/COS---//
+//-------------//
+// Приведение к [-pi/4, pi/4] по Коди—Уэйту с трёхчастным pi/2; для |x| > 1e6 и не конечных x — libm.
+// FAST — многочлены Чебышёва степени 4 по z = r^2 вместо 6
+template <bool FAST>
+static vdouble vsincos(vdouble x, int64_t quadrant) {
+    const double TWO_OVER_PI = 6.36619772367581382433e-01;
+    const double PIO2_1 = 1.57079632673412561417e+00, PIO2_2 = 6.07710050630396597660e-11,
+                 PIO2_3 = 2.02226624871116645580e-21, PIO2_3T = 8.47842766036889956997e-32;
+    const double S1 = -1.66666666666666324348e-01, S2 = 8.33333333332248946124e-03, S3 = -1.98412698298579493134e-04,
+                 S4 = 2.75573137070700676789e-06, S5 = -2.50507602534068634195e-08, S6 = 1.58969099521155010221e-10;
+    const double C1 = 4.16666666666666019037e-02, C2 = -1.38888888888741095749e-03, C3 = 2.48015872894767294178e-05,
+                 C4 = -2.75573143513906633035e-07, C5 = 2.08757232129817482790e-09, C6 = -1.13596475577881948265e-11;
+    vlong outside = ~((x <= 1e6) & (x >= -1e6));
+    vdouble xr = outside ? splat(0.0) : x;
+    vdouble t = xr * TWO_OVER_PI + SHIFT;
+    vdouble n = t - SHIFT;
+    vlong q = round_to_long(t) + quadrant;
+    vdouble r = ((xr - n * PIO2_1) - n * PIO2_2) - n * PIO2_3;
+    r = r - n * PIO2_3T;
+    vdouble z = r * r;
+    vdouble sin_r, cos_r;
+    if constexpr (FAST) {
+        const double FS1 = -0.16666666666663885, FS2 = 0.008333333331078323, FS3 = -0.00019841266916110632,
+                     FS4 = 2.7555990664728974e-06, FS5 = -2.4805611712122475e-08;
+        const double FC1 = 0.04166666666666468, FC2 = -0.0013888888887276698, FC3 = 2.480158521036455e-05,
+                     FC4 = -2.755636950618061e-07, FC5 = 2.0700582941271302e-09;
+        vdouble z2 = z * z, z4 = z2 * z2;
+        sin_r = r + r * z * ((FS1 + z * FS2) + z2 * (FS3 + z * FS4) + z4 * FS5);
+        cos_r = 1.0 - (0.5 * z - z2 * ((FC1 + z * FC2) + z2 * (FC3 + z * FC4) + z4 * FC5));
+    } else {
+        sin_r = r + r * z * (S1 + z * (S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)))));
+        cos_r = 1.0 - (0.5 * z - z * z * (C1 + z * (C2 + z * (C3 + z * (C4 + z * (C5 + z * C6))))));
+    }
+    vdouble res = (q & 1) ? cos_r : sin_r;
+    res = (q & 2) ? -res : res;
+    if (any(outside)) {
+        for (size_t i = 0; i < LANES; ++i)
+            if (outside[i]) res[i] = quadrant ? std::cos(x[i]) : std::sin(x[i]);
+    }
+    return res;
+}
+template <bool FAST>
+static vdouble vsin(vdouble x) {
+    return vsincos<FAST>(x, 0);
+}
+template <bool FAST>
+static vdouble vcos(vdouble x) {
+    return vsincos<FAST>(x, 1);
+}
+
+
+//-------------//
+//---KERNELS---//
+//-------------//
+template <typename F>
+static void map_unary(const double *x, double *out, size_t n, F f) {
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES)
+        store(out + i, f(load(x + i)));
+    if (i < n) {
+        double buffer[LANES] = {};
+        std::memcpy(buffer, x + i, (n - i) * sizeof(double));
+        store(buffer, f(load(buffer)));
+        std::memcpy(out + i, buffer, (n - i) * sizeof(double));
+    }
+}
+template <typename F>
+static void map_binary(const double *l, const double *r, double *out, size_t n, F f) {
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES)
+        store(out + i, f(load(l + i), load(r + i)));
+    for (; i < n; ++i)
+        out[i] = f(vdouble{} + l[i], vdouble{} + r[i])[0];
+}
+
+template <bool FAST>
+static void unary(char op, const double *x, double *out, size_t n) {
+    switch (op) {
+        case 's': return map_unary(x, out, n, [](vdouble v) { return vsin<FAST>(v); });
+        case 'c': return map_unary(x, out, n, [](vdouble v) { return vcos<FAST>(v); });
+        case 'l': return map_unary(x, out, n, [](vdouble v) { return vlog<FAST>(v); });
+        case 'e': return map_unary(x, out, n, [](vdouble v) { return vexp<FAST>(v); });
+        default: throw std::runtime_error(std::string("Unknown operator: ") + op);
+    }
+}
+void kernel_unary(char op, const double *x, double *out, size_t n, MathMode mode) {
+    if (mode == MathMode::FAST) unary<true>(op, x, out, n);
+    else unary<false>(op, x, out, n);
+}
+void kernel_binary(char op, const double *l, const double *r, double *out, size_t n, MathMode) {
+    switch (op) {
+        case '+': return map_binary(l, r, out, n, [](vdouble a, vdouble b) { return a + b; });
+        case '-': return map_binary(l, r, out, n, [](vdouble a, vdouble b) { return a - b; });
+        case '*': return map_binary(l, r, out, n, [](vdouble a, vdouble b) { return a * b; });
+        case '/': return map_binary(l, r, out, n, [](vdouble a, vdouble b) { return a / b; });
+        case '^':
+            for (size_t i = 0; i < n; ++i)
+                out[i] = pow(l[i], r[i]);
+            return;
+        default: throw std::runtime_error(std::string("Unknown operator: ") + op);
+    }
+}
+
+// Показатель разбирается по битам один раз, а не для каждого элемента.
+// При p < 0 результат — 1 / x^|p|, кроме элементов, где x^|p| вне [2^-1021, 2^1021]: там обратное
+// было бы денормалом с потерей точности или нулём вместо денормала (x^|p| переполнился), и их считает pow
+void kernel_power(const double *x, int p, double *out, size_t n) {
+    unsigned k = p < 0 ? -p : p;
+    map_unary(x, out, n, [k, p](vdouble v) {
+        vdouble base = v, result = splat(1.0);
+        for (unsigned e = k; e; e >>= 1) {
+            if (e & 1) result = result * v;
+            if (e > 1) v = v * v;
+        }
+        if (p >= 0) return result;
+        const double LARGE = 0x1p1021, SMALL = 0x1p-1021;
+        vdouble inverse = 1.0 / result;
+        vlong outside = (result > LARGE) | (result < -LARGE) | ((result < SMALL) & (result > -SMALL));
+        if (any(outside))
+            for (size_t i = 0; i < LANES; ++i)
+                if (outside[i]) inverse[i] = std::pow(base[i], double(p));
+        return inverse;
+    });
+}
@@ -0,0 +1,43 @@
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+#include "Expression.hpp"
+
+#include <cstddef>
+
+// Точность векторных ядер double.
+// ACCURATE — ошибка sin, cos, exp, ln не превышает 2 ulp относительно libm.
+// FAST — те же приведение аргумента и особые случаи, но многочлены Чебышёва меньшей степени:
+// ошибка sin, cos, exp, ln не больше 2^10 ulp (относительная 2^-42 для нормальных результатов).
+// Для прочих типов режим не меняет результата.
+enum class MathMode { ACCURATE, FAST };
+
+// Считается ли x^n с целым n умножениями, а не pow: в точном режиме при -3 <= n <= 4
+// (ошибка не больше 2 ulp относительно pow), в быстром — при |n| <= 64 (не больше 2^6 ulp)
+inline bool power_by_multiplication(int n, MathMode mode) {
+    return mode == MathMode::FAST ? (-64 <= n && n <= 64) : (-3 <= n && n <= 4);
+}
+
+// Поэлементные ядра над массивами: out[i] = op(x[i]) и out[i] = l[i] op r[i].
+// out может совпадать с любым из входов.
+// Для double операции + - * / и sin, cos, exp, ln векторизованы (расширения векторов GCC,
+// ширина зависит от -mavx), точность — по MathMode.
+// Для прочих типов (в том числе long double, который на x86-64 не векторизуется) — скалярный цикл.
+template <typename N>
+void kernel_unary(char op, const N *x, N *out, size_t n, MathMode = MathMode::ACCURATE) {
+    for (size_t i = 0; i < n; ++i)
+        out[i] = apply_unary(op, x[i]);
+}
+template <typename N>
+void kernel_binary(char op, const N *l, const N *r, N *out, size_t n, MathMode = MathMode::ACCURATE) {
+    for (size_t i = 0; i < n; ++i)
+        out[i] = apply_binary(op, l[i], r[i]);
+}
+
+void kernel_unary(char op, const double *x, double *out, size_t n, MathMode = MathMode::ACCURATE);
+void kernel_binary(char op, const double *l, const double *r, double *out, size_t n, MathMode = MathMode::ACCURATE);
+// out[i] = x[i]^p для целого p: возведением в квадрат, при p < 0 — 1 / x[i]^|p|
+// (там, где это обратное было бы денормалом или нулём, — через pow)
+void kernel_power(const double *x, int p, double *out, size_t n);
+
+#endif
@@ -0,0 +1,229 @@
+#include "Native.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Флаги сборки ядер входят в ключ кэша: другие флаги — другая библиотека
+static const char *NATIVE_FLAGS = "-O2 -shared -fPIC";
+
+
+//-------------------//
+//---CODEGENERATION--//
+//-------------------//
+// Константа точно: шестнадцатеричный литерал long double
+static std::string literal(T value) {
+    if (std::isnan(value)) return "__builtin_nanl(\"\")";
+    if (std::isinf(value)) return value > 0 ? "__builtin_huge_vall()" : "-__builtin_huge_vall()";
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%LaL", value);
+    return buf;
+}
+
+// Функции библиотеки вызываются в double, как и при вычислении дерева, чтобы результаты совпадали
+static std::string unary_call(char op, const std::string &x) {
+    switch (op) {
+        case 's': return "sin((double)" + x + ")";
+        case 'c': return "cos((double)" + x + ")";
+        case 'l': return "log((double)" + x + ")";
+        case 'e': return "exp((double)" + x + ")";
+        default: throw std::runtime_error(std::string("Unknown operator: ") + op);
+    }
+}
+
+std::string native_source(const NodeStore &store, const std::vector<NodeStore::Id> &roots,
+                          const std::vector<std::string> &variables) {
+    std::string code = "#include <math.h>\n#include <stddef.h>\n\n";
+    code += "static inline void body(const long double *s, long double *out) {\n";
+    std::vector<bool> emitted(store.size());
+    for (NodeStore::Id root : roots) {
+        std::vector<std::pair<NodeStore::Id, bool>> stack = {{root, false}};
+        while (!stack.empty()) {
+            auto [id, visited] = stack.back();
+            stack.pop_back();
+            if (emitted[id]) continue;
+            const Node &node = store[id];
+            int n = arity(node.op);
+            if (!visited && n > 0) {
+                stack.push_back({id, true});
+                if (n == 2) stack.push_back({node.b, false});
+                stack.push_back({node.a, false});
+                continue;
+            }
+            std::string a = "r" + std::to_string(node.a), b = "r" + std::to_string(node.b), value;
+            if (node.op == 'n') {
+                value = literal(node.value);
+            } else if (node.op == 'v') {
+                size_t slot = 0;
+                while (slot < variables.size() && variables[slot] != store.name(id)) ++slot;
+                value = slot < variables.size() ? "s[" + std::to_string(slot) + "]" : "0.0L";
+            } else if (n == 1) {
+                value = unary_call(node.op, a);
+            } else if (node.op == '^') {
+                value = "pow((double)" + a + ", (double)" + b + ")";
+            } else {
+                value = a + ' ' + node.op + ' ' + b;
+            }
+            code += "    const long double r" + std::to_string(id) + " = " + value + ";\n";
+            emitted[id] = true;
+        }
+    }
+    for (size_t k = 0; k < roots.size(); ++k)
+        code += "    out[" + std::to_string(k) + "] = r" + std::to_string(roots[k]) + ";\n";
+    code += "}\n\n";
+
+    std::string slots = std::to_string(std::max<size_t>(variables.size(), 1));
+    code += "extern \"C\" void kernel(const long double *s, long double *out) {\n";
+    code += "    body(s, out);\n}\n\n";
+    code += "extern \"C\" void kernel_batch(const long double *const *columns, size_t rows, long double *out) {\n";
+    code += "    for (size_t i = 0; i < rows; ++i) {\n";
+    code += "        long double s[" + slots + "];\n";
+    code += "        for (size_t j = 0; j < " + std::to_string(variables.size()) + "; ++j) s[j] = columns[j][i];\n";
+    code += "        body(s, out + i * " + std::to_string(roots.size()) + ");\n";
+    code += "    }\n}\n";
+    return code;
+}
+
+
+//-----------//
+//---CACHE---//
+//-----------//
+// Только каталог пользователя: из общего каталога (/tmp) можно было бы загрузить чужую библиотеку
+std::string native_cache_dir() {
+    if (const char *dir = std::getenv("DIFFERENTIATOR_CACHE")) return dir;
+    if (const char *dir = std::getenv("XDG_CACHE_HOME")) return std::string(dir) + "/differentiator";
+    if (const char *home = std::getenv("HOME")) return std::string(home) + "/.cache/differentiator";
+    return "";
+}
+
+static std::string hash_key(const std::string &text) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)h);
+    return buf;
+}
+
+// Библиотека из кэша годится, если рядом лежит ровно тот текст, из которого она собрана (хеш мог
+// совпасть у разных текстов, файл мог остаться от другой версии), и обе принадлежат пользователю
+// и недоступны другим на запись
+static bool cached_library(const std::string &text, const std::string &path) {
+    for (const std::string &file : {path, path + ".cpp"}) {
+        struct stat info;
+        if (stat(file.c_str(), &info) != 0 || info.st_uid != getuid() || (info.st_mode & (S_IWGRP | S_IWOTH)))
+            return false;
+    }
+    std::ifstream file(path + ".cpp", std::ios::binary);
+    std::string stored((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return stored == text;
+}
+
+// Сборка во временный файл и переименование: параллельные процессы не увидят недописанную библиотеку.
+// Текст остаётся рядом с библиотекой для проверки в cached_library()
+static bool build_library(const std::string &text, const std::string &path, const std::string &compiler) {
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    std::string temporary = path + "." + std::to_string(getpid());
+    {
+        std::ofstream file(temporary + ".cpp", std::ios::binary);
+        if (!(file << text)) return false;
+    }
+    std::string command = compiler + " " + NATIVE_FLAGS + " -o '" + temporary + "' '" + temporary + ".cpp' 2>/dev/null";
+    bool built = std::system(command.c_str()) == 0;
+    if (built) built = std::rename(temporary.c_str(), path.c_str()) == 0 &&
+                       std::rename((temporary + ".cpp").c_str(), (path + ".cpp").c_str()) == 0;
+    if (!built) {
+        std::remove(temporary.c_str());
+        std::remove((temporary + ".cpp").c_str());
+    }
+    return built;
+}
+
+
+//--------------------//
+//---NATIVEFUNCTION---//
+//--------------------//
+NativeFunction::NativeFunction(const Expression &expr, const std::vector<std::string> &by,
+                               const std::string &cache_dir) {
+    names = compile(expr).variables;
+    trees.push_back(expr.clone());
+    for (const std::string &x : by) {
+        trees.push_back(expr.differentiate(x));
+        simplify(trees.back());
+    }
+    NodeStore store;
+    std::vector<NodeStore::Id> roots;
+    for (const std::unique_ptr<Expression> &tree : trees) roots.push_back(store.insert(*tree));
+
+    std::string directory = cache_dir.empty() ? native_cache_dir() : cache_dir;
+    if (directory.empty()) return;
+    const char *cxx = std::getenv("CXX");
+    std::string compiler = (cxx && *cxx ? cxx : "c++");
+    // компилятор и флаги — в первой строке текста, а значит, и в ключе
+    std::string text = "// " + compiler + " " + NATIVE_FLAGS + "\n" + native_source(store, roots, names);
+    std::string path = directory + "/" + hash_key(text) + ".so";
+    if (!cached_library(text, path) && !build_library(text, path, compiler)) return;
+    library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!library) return;
+    kernel = reinterpret_cast<Kernel>(dlsym(library, "kernel"));
+    batch_kernel = reinterpret_cast<BatchKernel>(dlsym(library, "kernel_batch"));
+    if (!kernel || !batch_kernel) {
+        dlclose(library);
+        library = nullptr;
+        kernel = nullptr;
+        batch_kernel = nullptr;
+    }
+}
+NativeFunction::~NativeFunction() {
+    if (library) dlclose(library);
+}
+
+bool NativeFunction::is_native() const {
+    return kernel != nullptr;
+}
+const std::vector<std::string>& NativeFunction::variables() const {
+    return names;
+}
+size_t NativeFunction::outputs() const {
+    return trees.size();
+}
+
+void NativeFunction::evaluate(const T *slots, T *out) const {
+    if (kernel) {
+        kernel(slots, out);
+        return;
+    }
+    std::map<std::string, T> point;
+    for (size_t i = 0; i < names.size(); ++i) point[names[i]] = slots[i];
+    for (size_t k = 0; k < trees.size(); ++k) out[k] = trees[k]->evaluate(point);
+}
+T NativeFunction::evaluate(const std::map<std::string, T> &x) const {
+    std::vector<T> slots(names.size()), out(trees.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+        auto it = x.find(names[i]);
+        slots[i] = (it != x.end()) ? it->second : T{};
+    }
+    evaluate(slots.data(), out.data());
+    return out[0];
+}
+void NativeFunction::evaluate_batch(const T *const *columns, size_t rows, T *out) const {
+    if (batch_kernel) {
+        batch_kernel(columns, rows, out);
+        return;
+    }
+    std::vector<T> slots(names.size());
+    for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < names.size(); ++j) slots[j] = columns[j][i];
+        evaluate(slots.data(), out + i * trees.size());
+    }
+}
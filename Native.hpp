@@ -0,0 +1,54 @@
+#ifndef NATIVE_HPP
+#define NATIVE_HPP
+
+#include "Dag.hpp"
+
+#include <vector>
+
+// Выражение и его первые производные, скомпилированные в машинный код.
+// По выражению (общие подвыражения вычисляются один раз) генерируется C++, который собирается
+// системным компилятором ($CXX, иначе c++) в разделяемую библиотеку и загружается через dlopen.
+// Библиотеки кэшируются на диске по хешу сгенерированного текста, рядом с текстом, из которого собраны:
+// повторный запуск с тем же выражением компиляцию пропускает, если сохранённый текст совпадает.
+// Каталог кэша: $DIFFERENTIATOR_CACHE, иначе $XDG_CACHE_HOME/differentiator, иначе ~/.cache/differentiator;
+// без каталога пользователя машинный код не используется.
+// Если компилятора нет или загрузка не удалась, значения считаются по деревьям — результат тот же.
+class NativeFunction {
+public:
+    // by — переменные, по которым нужны производные; cache_dir == "" — каталог по умолчанию
+    explicit NativeFunction(const Expression &, const std::vector<std::string> &by = {},
+                            const std::string &cache_dir = "");
+    ~NativeFunction();
+    NativeFunction(const NativeFunction &) = delete;
+    NativeFunction& operator=(const NativeFunction &) = delete;
+
+    bool is_native() const;
+    // порядок слотов во входных данных
+    const std::vector<std::string>& variables() const;
+    // число выходов: значение и производные по by в том же порядке
+    size_t outputs() const;
+
+    // out[outputs()]
+    void evaluate(const T *slots, T *out) const;
+    T evaluate(const std::map<std::string, T> & = {}) const;
+    // по строкам столбцов, как evaluate_batch; out[row * outputs() + k]
+    void evaluate_batch(const T *const *columns, size_t rows, T *out) const;
+
+private:
+    using Kernel = void (*)(const T *, T *);
+    using BatchKernel = void (*)(const T *const *, size_t, T *);
+
+    std::vector<std::string> names;
+    std::vector<std::unique_ptr<Expression>> trees;
+    void *library = nullptr;
+    Kernel kernel = nullptr;
+    BatchKernel batch_kernel = nullptr;
+};
+
+// Текст C++ для корней roots хранилища: функции kernel(slots, out) и kernel_batch(columns, rows, out)
+std::string native_source(const NodeStore &, const std::vector<NodeStore::Id> &roots,
+                          const std::vector<std::string> &variables);
+// Каталог кэша по умолчанию; пустая строка — каталога пользователя нет
+std::string native_cache_dir();
+
+#endif
@@ -0,0 +1,179 @@
+#include "Parser.hpp"
+
+#include <algorithm>
+
+ParseError::ParseError(std::string message, size_t pos)
+    : std::runtime_error(message + " at position " + std::to_string(pos)), position(pos) {}
+
+static bool is_digit(char c) {
+    return ('0' <= c && c <= '9') || c == '.' || c == ',';
+}
+static bool is_name_char(char c) {
+    return ('A' <= c && c <= 'Z') || ('a' <= c && c <= 'z') || ('0' <= c && c <= '9') || c == '_';
+}
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+
+//---------------//
+//---TOKENIZER---//
+//---------------//
+Tokenizer::Tokenizer(std::string_view src) : source(src) {
+    advance();
+}
+const Tokenizer::Token& Tokenizer::peek() const {
+    return current;
+}
+Tokenizer::Token Tokenizer::next() {
+    Token token = current;
+    advance();
+    return token;
+}
+void Tokenizer::advance() {
+    while (pos < source.length() && is_space(source[pos]))
+        ++pos;
+    size_t start = pos;
+    if (pos == source.length()) {
+        current = {'\0', {}, start + 1};
+        return;
+    }
+    char c = source[pos];
+    if (is_digit(c)) {
+        int dot_count = 0, digit_count = 0;
+        while (pos < source.length() && is_digit(source[pos])) {
+            if (source[pos] == '.' || source[pos] == ',') ++dot_count;
+            else ++digit_count;
+            ++pos;
+        }
+        // мнимая единица: 2i, 0.5i
+        if (pos < source.length() && source[pos] == 'i' && (pos + 1 == source.length() || !is_name_char(source[pos + 1])))
+            ++pos;
+        if (dot_count > 1 || digit_count == 0)
+            throw ParseError(std::string("Invalid number '") + std::string(source.substr(start, pos - start)) + "'", start + 1);
+        current = {'n', source.substr(start, pos - start), start + 1};
+        return;
+    }
+    if (is_name_char(c)) {
+        while (pos < source.length() && is_name_char(source[pos]))
+            ++pos;
+        current = {'a', source.substr(start, pos - start), start + 1};
+        return;
+    }
+    switch (c) {
+        case '(': case ')': case '+': case '-': case '*': case '/': case '^':
+            ++pos;
+            current = {c, source.substr(start, 1), start + 1};
+            return;
+    }
+    throw ParseError(std::string("Unexpected symbol '") + c + "'", start + 1);
+}
+
+
+//------------//
+//---PARSER---//
+//------------//
+template <typename N>
+BasicParser<N>::BasicParser(std::string_view source) : tokens(source) {}
+
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicParser<N>::parse() {
+    if (tokens.peek().type == '\0')
+        return std::make_unique<BasicConstant<N>>(0);
+    std::unique_ptr<BasicExpression<N>> result = parse_expression();
+    const Tokenizer::Token &rest = tokens.peek();
+    if (rest.type == ')')
+        throw ParseError("Unmatched ')'", rest.position);
+    if (rest.type != '\0')
+        throw ParseError(std::string("Unexpected '") + std::string(rest.text) + "'", rest.position);
+    return result;
+}
+
+// Цепочки операций одного приоритета собираются циклом. Где прежний разбор уходил в рекурсию
+// (правый операнд, аргумент, скобки, операнд знака), в стек кладётся кадр, и разбор начинается заново;
+// готовое значение поднимается по кадрам, пока не найдётся тот, которому нужен ещё один операнд.
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicParser<N>::parse_expression() {
+    stack.clear();
+    stack.push_back({Frame::EXPRESSION, 1});
+    while (true) {
+        std::unique_ptr<BasicExpression<N>> value = parse_primary(stack.back().min_prec);
+        if (!value) continue;
+        while (true) {
+            Frame &top = stack.back();
+            if (top.kind == Frame::EXPRESSION) {
+                top.left = top.left ? std::make_unique<BasicBinary<N>>(top.op, std::move(top.left), std::move(value))
+                                    : std::move(value);
+                char op = tokens.peek().type;
+                int prec = precedence(op);
+                if (prec != 0 && prec >= top.min_prec) {
+                    tokens.next();
+                    top.op = op;
+                    stack.push_back({Frame::EXPRESSION, prec + 1});
+                    break;
+                }
+                value = std::move(top.left);
+            } else if (top.kind == Frame::FUNCTION) {
+                expect(')', "Expected a ')'");
+                value = std::make_unique<BasicUnary<N>>(top.op, std::move(value));
+            } else if (top.kind == Frame::PARENTHESES) {
+                expect(')', "Expected a ')'");
+            } else {
+                value = std::make_unique<BasicBinary<N>>(top.op, std::make_unique<BasicConstant<N>>(0), std::move(value));
+            }
+            stack.pop_back();
+            if (stack.empty()) return value;
+        }
+    }
+}
+
+// Лист — сразу значение; начало вложенной конструкции — новый кадр и nullptr
+template <typename N>
+std::unique_ptr<BasicExpression<N>> BasicParser<N>::parse_primary(int min_prec) {
+    Tokenizer::Token token = tokens.next();
+    switch (token.type) {
+        case 'n':
+            return std::make_unique<BasicConstant<N>>(to_number<N>(token.text));
+        case 'a': {
+            for (auto op: UNARY_OPERATORS) {
+                if (token.text != op.second) continue;
+                if (tokens.peek().type != '(')
+                    throw ParseError(std::string("Expected a '(...)' after '") + op.second + "'", tokens.peek().position);
+                tokens.next();
+                stack.push_back({Frame::FUNCTION, 0, op.first});
+                stack.push_back({Frame::EXPRESSION, 1});
+                return nullptr;
+            }
+            if constexpr (is_complex_v<N>) {
+                if (token.text == "i") return std::make_unique<BasicConstant<N>>(N(0, 1));
+            }
+            return std::make_unique<BasicVariable<N>>(std::string(token.text));
+        }
+        case '(':
+            stack.push_back({Frame::PARENTHESES});
+            stack.push_back({Frame::EXPRESSION, 1});
+            return nullptr;
+        case '-': case '+':
+            // унарный знак: -x^2 == 0 - x^2, -x*y == 0 - x*y, 2^-x*y == 2^(0 - x) * y
+            stack.push_back({Frame::SIGN, 0, token.type});
+            stack.push_back({Frame::EXPRESSION, std::max(min_prec, precedence('*'))});
+            return nullptr;
+        case '\0':
+            throw ParseError("Unexpected end of expression", token.position);
+        default:
+            throw ParseError(std::string("Unexpected '") + std::string(token.text) + "'", token.position);
+    }
+}
+
+template <typename N>
+void BasicParser<N>::expect(char type, const char *message) {
+    const Tokenizer::Token &token = tokens.peek();
+    if (token.type != type)
+        throw ParseError(message, token.position);
+    tokens.next();
+}
+
+template class BasicParser<float>;
+template class BasicParser<double>;
+template class BasicParser<long double>;
+template class BasicParser<std::complex<double>>;
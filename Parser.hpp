@@ -0,0 +1,77 @@
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
+#include "Expression.hpp"
+
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+// Ошибка разбора с позицией (с единицы) символа, на котором она обнаружена
+class ParseError : public std::runtime_error {
+public:
+    size_t position;
+    ParseError(std::string, size_t);
+};
+
+// Однопроходный токенизатор: выдаёт лексемы по запросу, не копируя исходную строку
+class Tokenizer {
+public:
+    // 'n' — число, 'a' — имя, '(' ')' + - * / ^ — сами символы, '\0' — конец ввода
+    struct Token {
+        char type;
+        std::string_view text;
+        size_t position;
+    };
+
+    explicit Tokenizer(std::string_view);
+    const Token& peek() const;
+    Token next();
+
+private:
+    std::string_view source;
+    size_t pos = 0;
+    Token current;
+    void advance();
+};
+
+// Разбор методом подъёма по приоритетам за линейное время от длины строки.
+// Строит то же дерево Constant/Variable/Unary/Binary, что и прежний рекурсивный разбор:
+// все бинарные операции левоассоциативны, унарный минус -x разворачивается в (0 - x).
+// Для комплексного N имя i — мнимая единица, а число с суффиксом i — мнимое.
+// Вложенность (скобки, функции, знаки, правые операнды) хранится в явном стеке, а не в стеке вызовов.
+template <typename N>
+class BasicParser {
+public:
+    explicit BasicParser(std::string_view);
+    std::unique_ptr<BasicExpression<N>> parse();
+
+private:
+    // Незаконченная конструкция: EXPRESSION — цепочка операций с приоритетом не ниже min_prec,
+    // FUNCTION — аргумент функции op, PARENTHESES — выражение в скобках, SIGN — операнд унарного op
+    struct Frame {
+        enum Kind { EXPRESSION, FUNCTION, PARENTHESES, SIGN } kind;
+        int min_prec = 0;
+        char op = 0;
+        std::unique_ptr<BasicExpression<N>> left = nullptr;
+    };
+    Tokenizer tokens;
+    std::vector<Frame> stack;
+    std::unique_ptr<BasicExpression<N>> parse_expression();
+    std::unique_ptr<BasicExpression<N>> parse_primary(int);
+    void expect(char, const char *);
+};
+
+using Parser = BasicParser<T>;
+
+// Приоритет бинарной операции; 0 — не бинарная операция. Общий для разбора, печати и compiletime
+constexpr int precedence(char op) {
+    switch (op) {
+        case '+': case '-': return 1;
+        case '*': case '/': return 2;
+        case '^': return 3;
+        default: return 0;
+    }
+}
+
+#endif
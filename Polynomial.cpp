@@ -0,0 +1,433 @@
+#include "Polynomial.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+//----------------//
+//---POLYNOMIAL---//
+//----------------//
+Polynomial::Polynomial(T value) : coefficient{value} {}
+
+Polynomial Polynomial::variable(const std::string &x) {
+    Polynomial p;
+    p.names = {x};
+    p.degree = {1};
+    p.coefficient = {0, 1};
+    return p;
+}
+
+const std::vector<std::string>& Polynomial::variables() const {
+    return names;
+}
+const std::vector<uint32_t>& Polynomial::degrees() const {
+    return degree;
+}
+const std::vector<T>& Polynomial::coefficients() const {
+    return coefficient;
+}
+size_t Polynomial::size() const {
+    return coefficient.size();
+}
+bool Polynomial::is_constant() const {
+    return names.empty();
+}
+T Polynomial::constant() const {
+    return coefficient[0];
+}
+
+size_t Polynomial::stride(size_t i) const {
+    size_t s = 1;
+    for (size_t j = i + 1; j < degree.size(); ++j) s *= degree[j] + 1;
+    return s;
+}
+
+// Те же коэффициенты в раскладке с другими переменными и степенями; переменная, которой
+// в новой раскладке нет, может входить только в нулевой степени
+Polynomial Polynomial::reshape(const std::vector<std::string> &to_names, const std::vector<uint32_t> &to_degrees) const {
+    if (to_names == names && to_degrees == degree) return *this;
+    Polynomial result;
+    result.names = to_names;
+    result.degree = to_degrees;
+    size_t total = 1;
+    for (uint32_t d : to_degrees) total *= d + 1;
+    result.coefficient.assign(total, 0);
+    std::vector<size_t> target(names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+        size_t j = std::lower_bound(to_names.begin(), to_names.end(), names[i]) - to_names.begin();
+        target[i] = (j < to_names.size() && to_names[j] == names[i]) ? result.stride(j) : 0;
+    }
+    for (size_t index = 0; index < coefficient.size(); ++index) {
+        if (coefficient[index] == T(0)) continue;
+        size_t rest = index, to = 0;
+        for (size_t i = names.size(); i-- > 0;) {
+            to += (rest % (degree[i] + 1)) * target[i];
+            rest /= degree[i] + 1;
+        }
+        result.coefficient[to] = coefficient[index];
+    }
+    return result;
+}
+
+// Степени сокращаются до наибольших, при которых есть ненулевой коэффициент
+void Polynomial::trim() {
+    std::vector<uint32_t> used(names.size(), 0);
+    for (size_t index = 0; index < coefficient.size(); ++index) {
+        if (coefficient[index] == T(0)) continue;
+        size_t rest = index;
+        for (size_t i = names.size(); i-- > 0;) {
+            used[i] = std::max<uint32_t>(used[i], rest % (degree[i] + 1));
+            rest /= degree[i] + 1;
+        }
+    }
+    if (used == degree) return;
+    std::vector<std::string> kept_names;
+    std::vector<uint32_t> kept_degrees;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (used[i] == 0) continue;
+        kept_names.push_back(names[i]);
+        kept_degrees.push_back(used[i]);
+    }
+    *this = reshape(kept_names, kept_degrees);
+}
+
+// Общая раскладка двух многочленов: объединение переменных, степени — наибольшая или сумма
+static void layout(const Polynomial &a, const Polynomial &b, bool product,
+                   std::vector<std::string> &names, std::vector<uint32_t> &degrees) {
+    const std::vector<std::string> &an = a.variables(), &bn = b.variables();
+    size_t i = 0, j = 0;
+    while (i < an.size() || j < bn.size()) {
+        if (j == bn.size() || (i < an.size() && an[i] < bn[j])) {
+            names.push_back(an[i]);
+            degrees.push_back(a.degrees()[i++]);
+        } else if (i == an.size() || bn[j] < an[i]) {
+            names.push_back(bn[j]);
+            degrees.push_back(b.degrees()[j++]);
+        } else {
+            uint32_t da = a.degrees()[i++], db = b.degrees()[j++];
+            names.push_back(an[i - 1]);
+            degrees.push_back(product ? da + db : std::max(da, db));
+        }
+    }
+}
+
+size_t combined_size(const Polynomial &a, const Polynomial &b, bool product) {
+    size_t total = 1, i = 0, j = 0;
+    while ((i < a.names.size() || j < b.names.size()) && total <= POLYNOMIAL_MAX_COEFFICIENTS) {
+        uint32_t d;
+        if (j == b.names.size() || (i < a.names.size() && a.names[i] < b.names[j])) {
+            d = a.degree[i++];
+        } else if (i == a.names.size() || b.names[j] < a.names[i]) {
+            d = b.degree[j++];
+        } else {
+            uint32_t da = a.degree[i++], db = b.degree[j++];
+            d = product ? da + db : std::max(da, db);
+        }
+        total *= d + 1;
+    }
+    return total;
+}
+
+Polynomial operator+(const Polynomial &a, const Polynomial &b) {
+    std::vector<std::string> names;
+    std::vector<uint32_t> degrees;
+    layout(a, b, false, names, degrees);
+    Polynomial result = a.reshape(names, degrees), right = b.reshape(names, degrees);
+    for (size_t i = 0; i < result.coefficient.size(); ++i) result.coefficient[i] += right.coefficient[i];
+    result.trim();
+    return result;
+}
+Polynomial operator-(const Polynomial &a, const Polynomial &b) {
+    return a + b / T(-1);
+}
+// В раскладке произведения индекс x^(i + j) равен сумме индексов x^i и x^j
+Polynomial operator*(const Polynomial &a, const Polynomial &b) {
+    std::vector<std::string> names;
+    std::vector<uint32_t> degrees;
+    layout(a, b, true, names, degrees);
+    Polynomial left = a.reshape(names, degrees), right = b.reshape(names, degrees);
+    Polynomial result = Polynomial().reshape(names, degrees);
+    for (size_t i = 0; i < left.coefficient.size(); ++i) {
+        if (left.coefficient[i] == T(0)) continue;
+        for (size_t j = 0; i + j < right.coefficient.size(); ++j)
+            if (right.coefficient[j] != T(0)) result.coefficient[i + j] += left.coefficient[i] * right.coefficient[j];
+    }
+    result.trim();
+    return result;
+}
+Polynomial operator/(const Polynomial &a, T c) {
+    Polynomial result = a;
+    for (T &k : result.coefficient) k /= c;
+    return result;
+}
+
+Polynomial Polynomial::derivative(const std::string &x) const {
+    size_t v = std::lower_bound(names.begin(), names.end(), x) - names.begin();
+    if (v == names.size() || names[v] != x) return Polynomial(0);
+    Polynomial result = *this;
+    std::fill(result.coefficient.begin(), result.coefficient.end(), T(0));
+    size_t s = stride(v);
+    for (size_t index = 0; index < coefficient.size(); ++index) {
+        size_t e = (index / s) % (degree[v] + 1);
+        if (e > 0 && coefficient[index] != T(0)) result.coefficient[index - s] += T(e) * coefficient[index];
+    }
+    result.trim();
+    return result;
+}
+
+// У последней переменной коэффициенты соседние: каждый блок сворачивается схемой Горнера
+// в одно значение, и массив становится многочленом от оставшихся переменных
+T Polynomial::evaluate(const T *values) const {
+    std::vector<T> work = coefficient;
+    size_t n = work.size();
+    for (size_t v = degree.size(); v-- > 0;) {
+        size_t block = degree[v] + 1;
+        n /= block;
+        for (size_t i = 0; i < n; ++i) {
+            T acc = 0;
+            for (size_t e = block; e-- > 0;) acc = acc * values[v] + work[i * block + e];
+            work[i] = acc;
+        }
+    }
+    return work[0];
+}
+T Polynomial::evaluate(const std::map<std::string, T> &x) const {
+    std::vector<T> values(names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+        auto it = x.find(names[i]);
+        values[i] = (it != x.end()) ? it->second : T{};
+    }
+    return evaluate(values.data());
+}
+
+std::unique_ptr<Expression> Polynomial::expression() const {
+    std::unique_ptr<Expression> result = horner(0, 0);
+    return result ? std::move(result) : Expression::create(T(0));
+}
+
+// ((c_d * x + c_(d-1)) * x + ...) * x + c_0, где c_e — многочлены от следующих переменных
+// (рекурсия только по переменным, её глубина не больше их числа); nullptr — нулевой многочлен
+std::unique_ptr<Expression> Polynomial::horner(size_t v, size_t offset) const {
+    if (v == names.size())
+        return coefficient[offset] == T(0) ? nullptr : Expression::create(coefficient[offset]);
+    std::unique_ptr<Expression> result;
+    size_t s = stride(v);
+    for (size_t e = degree[v] + 1; e-- > 0;) {
+        if (result) {
+            bool unit = result->operation() == 'n' && static_cast<const Constant &>(*result).get_value() == T(1);
+            if (unit) result = std::make_unique<Variable>(names[v]);
+            else result = std::make_unique<Binary>('*', std::move(result), std::make_unique<Variable>(names[v]));
+        }
+        std::unique_ptr<Expression> c = horner(v + 1, offset + e * s);
+        if (!c) continue;
+        if (!result) {
+            result = std::move(c);
+        } else if (c->operation() == 'n' && static_cast<const Constant &>(*c).get_value() < 0) {
+            T value = static_cast<const Constant &>(*c).get_value();
+            result = std::make_unique<Binary>('-', std::move(result), Expression::create(-value));
+        } else {
+            result = std::make_unique<Binary>('+', std::move(result), std::move(c));
+        }
+    }
+    return result;
+}
+
+
+//-----------------//
+//---RECOGNITION---//
+//-----------------//
+namespace {
+// MONOMIAL — произведение констант и степеней переменных, SUM — сумма таких членов,
+// RATIONAL — отношение двух сумм; TREE — всё остальное, оно остаётся деревом
+enum Kind { TREE, MONOMIAL, SUM, RATIONAL };
+
+struct Part {
+    Kind kind = TREE;
+    Polynomial numerator, denominator;
+    std::unique_ptr<Expression> tree;        // значение узла TREE
+    std::unique_ptr<Expression> derivative;  // его производная (только для horner_derivative)
+};
+}
+
+static bool is_sum(const Part &p) {
+    return p.kind == MONOMIAL || p.kind == SUM;
+}
+static bool is_constant(const Part &p) {
+    return p.kind == MONOMIAL && p.numerator.is_constant();
+}
+static Part polynomial(Kind kind, Polynomial numerator, Polynomial denominator = {}) {
+    Part p;
+    p.kind = kind;
+    p.numerator = std::move(numerator);
+    p.denominator = std::move(denominator);
+    return p;
+}
+
+// Степень base^k целой k >= 0 возведением в квадрат; пустой результат — слишком много коэффициентов
+static std::optional<Polynomial> power(Polynomial base, uint32_t k) {
+    Polynomial result = 1;
+    while (k > 0) {
+        if (k & 1) {
+            if (combined_size(result, base, true) > POLYNOMIAL_MAX_COEFFICIENTS) return std::nullopt;
+            result = result * base;
+        }
+        k >>= 1;
+        if (k == 0) break;
+        if (combined_size(base, base, true) > POLYNOMIAL_MAX_COEFFICIENTS) return std::nullopt;
+        base = base * base;
+    }
+    return result;
+}
+
+// Вид узла op над уже разобранными операндами; TREE — узел остаётся деревом
+static Part combine(char op, Part &l, Part *r) {
+    if (!r) {
+        if (is_constant(l)) return polynomial(MONOMIAL, apply_unary(op, l.numerator.constant()));
+        return {};
+    }
+    if (is_constant(l) && is_constant(*r))
+        return polynomial(MONOMIAL, apply_binary(op, l.numerator.constant(), r->numerator.constant()));
+    if (!is_sum(l) || !is_sum(*r)) return {};
+    const Polynomial &a = l.numerator, &b = r->numerator;
+    switch (op) {
+        case '+': case '-':
+            if (combined_size(a, b, false) > POLYNOMIAL_MAX_COEFFICIENTS) return {};
+            return polynomial(SUM, op == '+' ? a + b : a - b);
+        case '*': {
+            // сумма умножается только на одночлен: произведения сумм не раскрываются
+            bool monomial = l.kind == MONOMIAL && r->kind == MONOMIAL;
+            if (!monomial && l.kind == SUM && r->kind == SUM) return {};
+            if (combined_size(a, b, true) > POLYNOMIAL_MAX_COEFFICIENTS) return {};
+            return polynomial(monomial ? MONOMIAL : SUM, a * b);
+        }
+        case '/':
+            if (is_constant(*r)) return b.constant() == T(0) ? Part{} : polynomial(l.kind, a / b.constant());
+            return polynomial(RATIONAL, a, b);
+        case '^': {
+            if (!is_constant(*r)) return {};
+            T k = b.constant();
+            if (k != std::floor(k) || std::fabs(k) > T(POLYNOMIAL_MAX_COEFFICIENTS)) return {};
+            if (l.kind == SUM && k != 1) return {};
+            std::optional<Polynomial> p = power(a, uint32_t(std::fabs(k)));
+            if (!p) return {};
+            return k >= 0 ? polynomial(l.kind, *p) : polynomial(RATIONAL, 1, *p);
+        }
+    }
+    return {};
+}
+
+static std::unique_ptr<Expression> value_tree(Part &p) {
+    switch (p.kind) {
+        case TREE: return std::move(p.tree);
+        case RATIONAL: return std::make_unique<Binary>('/', p.numerator.expression(), p.denominator.expression());
+        default: return p.numerator.expression();
+    }
+}
+
+// (n' * d - n * d') / (d * d); n и d — в форме Горнера
+static std::unique_ptr<Expression> derivative_tree(Part &p, const std::string &x) {
+    switch (p.kind) {
+        case TREE: return std::move(p.derivative);
+        case RATIONAL: {
+            std::unique_ptr<Expression> d = p.denominator.expression();
+            return std::make_unique<Binary>('/',
+                std::make_unique<Binary>('-',
+                    std::make_unique<Binary>('*', p.numerator.derivative(x).expression(), d->clone()),
+                    std::make_unique<Binary>('*', p.numerator.expression(), p.denominator.derivative(x).expression())),
+                std::make_unique<Binary>('*', d->clone(), d->clone()));
+        }
+        default: return p.numerator.derivative(x).expression();
+    }
+}
+
+// Правила дерева для узла, который сам не многочлен; a, b — значения операндов, da, db — их производные
+static std::unique_ptr<Expression> differentiate_node(char op, const Expression &a, const Expression *b,
+                                                      std::unique_ptr<Expression> da, std::unique_ptr<Expression> db) {
+    using E = std::unique_ptr<Expression>;
+    auto binary = [](char o, E l, E r) -> E { return std::make_unique<Binary>(o, std::move(l), std::move(r)); };
+    auto unary = [](char o, E e) -> E { return std::make_unique<Unary>(o, std::move(e)); };
+    switch (op) {
+        case 's': return binary('*', unary('c', a.clone()), std::move(da));
+        case 'c': return binary('*', binary('-', Expression::create(T(0)), unary('s', a.clone())), std::move(da));
+        case 'l': return binary('/', std::move(da), a.clone());
+        case 'e': return binary('*', unary('e', a.clone()), std::move(da));
+        case '+': case '-': return binary(op, std::move(da), std::move(db));
+        case '*': return binary('+', binary('*', std::move(da), b->clone()), binary('*', a.clone(), std::move(db)));
+        case '/':
+            return binary('/', binary('-', binary('*', std::move(da), b->clone()), binary('*', a.clone(), std::move(db))),
+                          binary('^', b->clone(), Expression::create(T(2))));
+        case '^':
+            if (b->operation() == 'n') {
+                T c = static_cast<const Constant *>(b)->get_value();
+                return binary('*', binary('*', Expression::create(c), binary('^', a.clone(), Expression::create(c - 1))),
+                              std::move(da));
+            }
+            return binary('*', binary('^', a.clone(), b->clone()),
+                          binary('+', binary('*', std::move(db), unary('l', a.clone())),
+                                 binary('*', b->clone(), binary('/', std::move(da), a.clone()))));
+        default: throw std::runtime_error(std::string("Unknown operator: ") + op);
+    }
+}
+
+// Снизу вверх с явным стеком. Многочлены копятся в Part, пока родитель тоже многочлен;
+// узел, который многочленом не стал, строит дерево из значений (и производных) операндов.
+// x == nullptr — только значения.
+static Part transform(const Expression &root, const std::string *x) {
+    std::vector<std::pair<const Expression *, bool>> stack = {{&root, false}};
+    std::vector<Part> parts;
+    while (!stack.empty()) {
+        auto [node, visited] = stack.back();
+        stack.pop_back();
+        char op = node->operation();
+        if (op == 'n') {
+            parts.push_back(polynomial(MONOMIAL, static_cast<const Constant *>(node)->get_value()));
+            continue;
+        }
+        if (op == 'v') {
+            parts.push_back(polynomial(MONOMIAL, Polynomial::variable(static_cast<const Variable *>(node)->get_name())));
+            continue;
+        }
+        bool binary = node->operand(1) != nullptr;
+        if (!visited) {
+            stack.push_back({node, true});
+            if (binary) stack.push_back({node->operand(1), false});
+            stack.push_back({node->operand(0), false});
+            continue;
+        }
+        Part right;
+        if (binary) {
+            right = std::move(parts.back());
+            parts.pop_back();
+        }
+        Part &left = parts.back();
+        Part result = combine(op, left, binary ? &right : nullptr);
+        if (result.kind == TREE) {
+            std::unique_ptr<Expression> da, db;
+            if (x) {
+                da = derivative_tree(left, *x);
+                if (binary) db = derivative_tree(right, *x);
+            }
+            std::unique_ptr<Expression> a = value_tree(left), b = binary ? value_tree(right) : nullptr;
+            if (x) result.derivative = differentiate_node(op, *a, b.get(), std::move(da), std::move(db));
+            result.tree = binary ? std::unique_ptr<Expression>(std::make_unique<Binary>(op, std::move(a), std::move(b)))
+                                 : std::make_unique<Unary>(op, std::move(a));
+        }
+        left = std::move(result);
+    }
+    return std::move(parts.back());
+}
+
+std::optional<Polynomial> as_polynomial(const Expression &expr) {
+    Part p = transform(expr, nullptr);
+    if (!is_sum(p)) return std::nullopt;
+    return std::move(p.numerator);
+}
+
+std::unique_ptr<Expression> horner(const Expression &expr) {
+    Part p = transform(expr, nullptr);
+    return value_tree(p);
+}
+
+std::unique_ptr<Expression> horner_derivative(const Expression &expr, const std::string &x) {
+    Part p = transform(expr, &x);
+    return derivative_tree(p, x);
+}
@@ -0,0 +1,66 @@
+#ifndef POLYNOMIAL_HPP
+#define POLYNOMIAL_HPP
+
+#include "Expression.hpp"
+
+#include <optional>
+#include <vector>
+
+// Больше коэффициентов плотный массив не хранит: такое поддерево остаётся деревом
+constexpr size_t POLYNOMIAL_MAX_COEFFICIENTS = 4096;
+
+// Многочлен от нескольких переменных с плотным массивом коэффициентов. Переменные упорядочены
+// по имени, degrees[i] — наибольшая степень i-й; коэффициент при x0^e0 * x1^e1 * ... лежит
+// по индексу sum(e_i * stride_i), у последней переменной stride = 1.
+class Polynomial {
+public:
+    Polynomial(T = 0);
+    static Polynomial variable(const std::string &);
+
+    const std::vector<std::string>& variables() const;
+    const std::vector<uint32_t>& degrees() const;
+    const std::vector<T>& coefficients() const;
+    size_t size() const;
+    bool is_constant() const;
+    T constant() const;
+
+    // Точная производная: коэффициенты сдвигаются на одну степень x и умножаются на показатель
+    Polynomial derivative(const std::string &x) const;
+    // Вложенная схема Горнера: сначала по последней переменной, затем по предыдущим.
+    // values — значения в порядке variables()
+    T evaluate(const T *values) const;
+    T evaluate(const std::map<std::string, T> & = {}) const;
+    // Дерево той же схемы Горнера: только + - *, без pow
+    std::unique_ptr<Expression> expression() const;
+
+    friend Polynomial operator+(const Polynomial &, const Polynomial &);
+    friend Polynomial operator-(const Polynomial &, const Polynomial &);
+    friend Polynomial operator*(const Polynomial &, const Polynomial &);
+    friend Polynomial operator/(const Polynomial &, T);
+    // число коэффициентов суммы (product = false) или произведения — чтобы проверить предел заранее
+    friend size_t combined_size(const Polynomial &, const Polynomial &, bool product);
+
+private:
+    std::vector<std::string> names;
+    std::vector<uint32_t> degree;
+    std::vector<T> coefficient;
+
+    size_t stride(size_t) const;
+    Polynomial reshape(const std::vector<std::string> &, const std::vector<uint32_t> &) const;
+    void trim();
+    std::unique_ptr<Expression> horner(size_t var, size_t offset) const;
+};
+
+// Многочлен, если выражение записано как сумма членов a * x^n * y^m ... (в том числе с делением на константу)
+std::optional<Polynomial> as_polynomial(const Expression &);
+
+// Максимальные поддеревья-многочлены в развёрнутой записи (суммы членов a * x^n) и отношения двух
+// таких многочленов перестраиваются по схеме Горнера без pow; остальное дерево копируется.
+// Произведения и степени сумм не раскрываются: (x - 1)^20 в развёрнутом виде теряет точность.
+std::unique_ptr<Expression> horner(const Expression &);
+// Производная, в которой многочлены дифференцируются сдвигом коэффициентов (отношения — по правилу
+// частного из многочленов), а остальные узлы — по правилам дерева; x^c с константой c — по правилу
+// степени c * x^(c - 1), без exp и ln. Результат — в форме Горнера, как у horner()
+std::unique_ptr<Expression> horner_derivative(const Expression &, const std::string &x);
+
+#endif
@@ -0,0 +1,191 @@
+#include "Printer.hpp"
+#include "Parser.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+constexpr size_t PRINT_BLOCK = 1 << 16;
+
+template <typename N>
+void append_number(std::string &out, N value) {
+    if constexpr (is_complex_v<N>) {
+        using R = typename N::value_type;
+        R re = value.real(), im = value.imag();
+        if (im == 0) return append_number(out, re);
+        bool both = re != 0;
+        if (both) {
+            out += '(';
+            append_number(out, re);
+            out += im < 0 ? " - " : " + ";
+        } else if (im < 0) {
+            out += '-';
+        }
+        if (im != 1 && im != -1) append_number(out, im < 0 ? -im : im);
+        out += both ? "i)" : "i";
+    } else {
+        // целые — напрямую, без форматирования с плавающей точкой
+        if (value == std::trunc(value) && value > -1e18L && value < 1e18L && !(value == 0 && std::signbit(value))) {
+            char buffer[24];
+            out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), int64_t(value)).ptr);
+            return;
+        }
+        // обычно хватает шести знаков после точки, как у std::to_string; иначе знаки добавляются,
+        // пока запись не прочтётся тем же to_number, что и при разборе, но не больше max_digits10 значащих
+        N magnitude = value < 0 ? -value : value;
+        int exponent = (magnitude > 0 && std::isfinite(magnitude)) ? int(std::floor(std::log10(magnitude))) : 0;
+        int max_decimals = std::max(6, std::numeric_limits<N>::max_digits10 - 1 - exponent);
+        char buffer[128];
+        std::string text;
+        for (int decimals = 6; decimals <= max_decimals; ++decimals) {
+            int n = std::snprintf(buffer, sizeof(buffer), "%.*Lf", decimals, (long double)value);
+            if (n < int(sizeof(buffer))) {
+                text.assign(buffer, n);
+            } else {
+                text.resize(n + 1);
+                text.resize(std::snprintf(text.data(), text.size(), "%.*Lf", decimals, (long double)value));
+            }
+            std::string_view digits(text);
+            if (!digits.empty() && digits[0] == '-') digits.remove_prefix(1);
+            if (!std::isfinite(value) || to_number<N>(digits) == magnitude) break;
+        }
+        out += delete_zeros(std::move(text));
+    }
+}
+
+// Приоритет узла при печати: константа, переменная и функция связывают сильнее любой операции
+static int binding(char op) {
+    return precedence(op) ? precedence(op) : 4;
+}
+template <typename N>
+static bool is_negative(N value) {
+    if constexpr (is_complex_v<N>) return value.imag() == 0 ? value.real() < 0 : value.real() == 0 && value.imag() < 0;
+    else return value < 0;
+}
+template <typename N>
+static bool is_binary(const BasicExpression<N> &e) {
+    return precedence(e.operation()) > 0;
+}
+// 0 - r печатается как -r, отрицательная константа — со знаком; разбор читает и то и другое
+// как унарный минус, операнд которого связывается с приоритетом не ниже 2
+template <typename N>
+static bool is_negation(const BasicExpression<N> &e) {
+    if (e.operation() == 'n') return is_negative(static_cast<const BasicConstant<N> &>(e).get_value());
+    if (e.operation() != '-' || e.operand(0)->operation() != 'n') return false;
+    N left = static_cast<const BasicConstant<N> *>(e.operand(0))->get_value();
+    if constexpr (is_complex_v<N>) return left == N(0) && !std::signbit(left.real());
+    else return left == 0 && !std::signbit(left);
+}
+
+// Скобки вокруг операнда child операции op; context — приоритет, с которым разбор читает саму операцию
+template <typename N>
+static bool needs_wrap(const BasicExpression<N> &child, char op, bool left, int context, Parentheses mode) {
+    if (mode == Parentheses::FULL) {
+        bool wrapped = is_binary(child) && child.operation() != '^';
+        // -2 * x читается как 0 - 2 * x: другой знак нуля, а при ^ и другое значение
+        if (left && is_negation(child) && precedence(op) >= 2) return true;
+        if (op == '^') return wrapped || (!left && child.operation() == '^');
+        return wrapped && !(op == '+' && left);
+    }
+    int p = precedence(op);
+    if (is_negation(child)) {
+        // слева минус забрал бы в свой операнд и саму операцию op
+        return left && p >= std::max(context, 2);
+    }
+    return left ? binding(child.operation()) < p : binding(child.operation()) <= p;
+}
+
+namespace {
+template <typename N>
+struct Task {
+    const BasicExpression<N> *node;  // nullptr — напечатать text
+    std::string_view text;
+    int context = 1;         // приоритет, с которым разбор читает это место
+    bool wrap = false;
+};
+}
+
+template <typename N>
+static void print(const BasicExpression<N> &root, std::string &out, std::ostream *stream, Parentheses mode, bool bare_root) {
+    bool wrap_root = mode == Parentheses::FULL && !bare_root && is_binary(root) && root.operation() != '^';
+    std::vector<Task<N>> stack = {{&root, {}, 1, wrap_root}};
+    while (!stack.empty()) {
+        Task<N> task = stack.back();
+        stack.pop_back();
+        if (stream && out.size() >= PRINT_BLOCK) {
+            stream->write(out.data(), out.size());
+            out.clear();
+        }
+        if (!task.node) {
+            out += task.text;
+            continue;
+        }
+        const BasicExpression<N> &node = *task.node;
+        int context = task.context;
+        if (task.wrap) {
+            out += '(';
+            stack.push_back({nullptr, ")"});
+            context = 1;
+        }
+        char op = node.operation();
+        if (op == 'n') {
+            append_number(out, static_cast<const BasicConstant<N> &>(node).get_value());
+        } else if (op == 'v') {
+            out += static_cast<const BasicVariable<N> &>(node).get_name();
+        } else if (!is_binary(node)) {
+            for (const auto &[code, name] : UNARY_OPERATORS)
+                if (code == op) out += name;
+            out += '(';
+            stack.push_back({nullptr, ")"});
+            stack.push_back({node.operand(0), {}, 1, false});
+        } else if (is_negation(node)) {
+            // операнд минуса читается с приоритетом не ниже 2; двойной минус — в скобках для читаемости
+            const BasicExpression<N> &operand = *node.operand(1);
+            int inner = std::max(context, 2);
+            bool wrap = is_negation(operand) ||
+                        (mode == Parentheses::FULL ? is_binary(operand) && operand.operation() != '^'
+                                                   : binding(operand.operation()) < inner);
+            out += '-';
+            stack.push_back({&operand, {}, inner, wrap});
+        } else {
+            static const std::string_view separators[] = {" + ", " - ", " * ", " / "};
+            std::string_view separator = op == '^' ? "^" : separators[std::string_view("+-*/").find(op)];
+            const BasicExpression<N> &left = *node.operand(0), &right = *node.operand(1);
+            stack.push_back({&right, {}, precedence(op) + 1, needs_wrap(right, op, false, context, mode)});
+            stack.push_back({nullptr, separator});
+            stack.push_back({&left, {}, context, needs_wrap(left, op, true, context, mode)});
+        }
+    }
+    if (stream) stream->write(out.data(), out.size());
+}
+
+template <typename N>
+void print(const BasicExpression<N> &root, std::string &out, Parentheses mode, bool bare_root) {
+    print(root, out, nullptr, mode, bare_root);
+}
+template <typename N>
+void print(const BasicExpression<N> &root, std::ostream &stream, Parentheses mode, bool bare_root) {
+    std::string buffer;
+    buffer.reserve(PRINT_BLOCK);
+    print(root, buffer, &stream, mode, bare_root);
+}
+template <typename N>
+std::string to_string(const BasicExpression<N> &root, Parentheses mode, bool bare_root) {
+    std::string out;
+    print(root, out, nullptr, mode, bare_root);
+    return out;
+}
+
+#define DIFFERENTIATOR_INSTANTIATE(N) \
+    template void print(const BasicExpression<N> &, std::string &, Parentheses, bool); \
+    template void print(const BasicExpression<N> &, std::ostream &, Parentheses, bool); \
+    template std::string to_string(const BasicExpression<N> &, Parentheses, bool); \
+    template void append_number(std::string &, N);
+DIFFERENTIATOR_INSTANTIATE(float)
+DIFFERENTIATOR_INSTANTIATE(double)
+DIFFERENTIATOR_INSTANTIATE(long double)
+DIFFERENTIATOR_INSTANTIATE(std::complex<double>)
+#undef DIFFERENTIATOR_INSTANTIATE
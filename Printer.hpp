@@ -0,0 +1,30 @@
+#ifndef PRINTER_HPP
+#define PRINTER_HPP
+
+#include "Expression.hpp"
+
+#include <ostream>
+
+// FULL — привычный вид to_string(): каждая бинарная операция, кроме ^, в скобках.
+// MINIMAL — скобки только там, где без них разбор дал бы другое дерево
+// (все операции левоассоциативны, унарный минус связывает операнд не слабее * и /).
+enum class Parentheses { FULL, MINIMAL };
+
+// Печать в конец out одним проходом с явным стеком: время линейно по длине результата,
+// выделения — только рост out. Скобки выбираются по приоритетам операций, а не по уже
+// напечатанной строке. Результат разбирается Expression::create обратно в то же значение,
+// константы печатаются с точностью, достаточной для этого. bare_root — без скобок вокруг всего выражения.
+template <typename N>
+void print(const BasicExpression<N> &, std::string &out, Parentheses = Parentheses::FULL, bool bare_root = false);
+// То же в поток: буфер сбрасывается блоками
+template <typename N>
+void print(const BasicExpression<N> &, std::ostream &, Parentheses = Parentheses::FULL, bool bare_root = false);
+template <typename N>
+std::string to_string(const BasicExpression<N> &, Parentheses, bool bare_root = false);
+
+// Кратчайшая запись константы без экспоненты, которая читается обратно в то же число;
+// комплексная — как a, bi или (a + bi)
+template <typename N>
+void append_number(std::string &out, N);
+
+#endif
@@ -0,0 +1,274 @@
+#include "Rewrite.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+void Rewriter::Collected::add(Id id, T k) {
+    auto [it, inserted] = index.try_emplace(id, terms.size());
+    if (inserted) terms.push_back({id, k});
+    else terms[it->second].k += k;
+}
+
+Rewriter::Rewriter(NodeStore &store, size_t budget) : store(store), budget(budget) {}
+
+bool Rewriter::is_sum(Id id) const {
+    return store[id].op == '+' || store[id].op == '-';
+}
+bool Rewriter::is_product(Id id) const {
+    return store[id].op == '*' || store[id].op == '/';
+}
+bool Rewriter::is_negation(Id id) const {
+    return store[id].op == '-' && is_constant(store[id].a) && value(store[id].a) == T(0);
+}
+bool Rewriter::is_constant(Id id) const {
+    return store[id].op == 'n';
+}
+T Rewriter::value(Id id) const {
+    return store[id].value;
+}
+
+static bool is_integer(T k) {
+    return std::imag(k) == 0 && std::floor(std::real(k)) == std::real(k);
+}
+static bool is_negative(T k) {
+    return std::real(k) < 0;
+}
+
+
+//---------------//
+//---FIXEDPOINT--//
+//---------------//
+Rewriter::Id Rewriter::run(Id root) {
+    limit = store.size() + budget;
+    for (int i = 0; i < REWRITE_MAX_PASSES; ++i) {
+        Id next = pass(root);
+        if (next == root) break;
+        root = next;
+    }
+    return root;
+}
+
+// Один проход; при исчерпании бюджета узлов проход отбрасывается
+Rewriter::Id Rewriter::pass(Id root) {
+    done.clear();
+    Id result = rewrite(root);
+    return store.size() > limit ? root : result;
+}
+
+// Снизу вверх с явным стеком. У цепочки + - (и * /) переписываются только листья,
+// а сама цепочка собирается целиком в узле, с которого она начинается.
+Rewriter::Id Rewriter::rewrite(Id root) {
+    std::vector<std::pair<Id, bool>> stack = {{root, false}};
+    std::vector<Id> chain_stack;
+    while (!stack.empty() && store.size() <= limit) {
+        auto [id, visited] = stack.back();
+        stack.pop_back();
+        if (done.count(id)) continue;
+        const Node node = store[id];
+        if (node.op == 'n' || node.op == 'v') {
+            done[id] = id;
+            continue;
+        }
+        if (!visited) {
+            stack.push_back({id, true});
+            chain_stack = {id};
+            while (!chain_stack.empty()) {
+                Id link = chain_stack.back();
+                chain_stack.pop_back();
+                if (link == id || (is_sum(id) ? is_sum(link) : is_product(id) && is_product(link))) {
+                    if (arity(store[link].op) == 2) chain_stack.push_back(store[link].b);
+                    chain_stack.push_back(store[link].a);
+                } else if (!done.count(link)) {
+                    stack.push_back({link, false});
+                }
+            }
+            continue;
+        }
+        Id result;
+        if (is_sum(id)) {
+            Collected sum;
+            sum_terms(id, 1, true, sum);
+            result = build_sum(sum);
+        } else if (is_product(id)) {
+            Collected product;
+            product.constant = 1;
+            product_factors(id, 1, true, product);
+            result = build_product(product);
+        } else if (node.op == '^') {
+            result = power(done.at(node.a), done.at(node.b));
+        } else {
+            result = unary(node.op, done.at(node.a));
+        }
+        done[id] = result;
+    }
+    return store.size() > limit ? root : done.at(root);
+}
+
+
+//-----------//
+//---RULES---//
+//-----------//
+Rewriter::Id Rewriter::unary(char op, Id a) {
+    if (is_constant(a)) return store.constant(apply_unary(op, value(a)));
+    if (op == 'l' && store[a].op == 'e') return store[a].a;
+    return store.unary(op, a);
+}
+
+// Целая степень раскрывается как произведение: (2 * x * y) ^ 2 -> 4 * x ^ 2 * y ^ 2
+Rewriter::Id Rewriter::power(Id a, Id b) {
+    if (is_constant(a) && is_constant(b)) return store.constant(apply_binary('^', value(a), value(b)));
+    if (is_constant(a) && (value(a) == T(0) || value(a) == T(1))) return a;
+    if (is_constant(b)) {
+        if (value(b) == T(0)) return store.constant(1);
+        if (is_integer(value(b))) {
+            Collected product;
+            product.constant = 1;
+            product_factors(a, value(b), false, product);
+            return build_product(product);
+        }
+    }
+    return store.binary('^', a, b);
+}
+
+// Слагаемые цепочки + - со знаком sign. Листья исходной (raw) цепочки берутся переписанными;
+// переписанный лист сам может оказаться суммой или отрицанием и тогда тоже разворачивается.
+void Rewriter::sum_terms(Id root, T sign, bool raw, Collected &sum) {
+    std::vector<std::tuple<Id, T, bool>> stack = {{root, sign, raw}};
+    while (!stack.empty()) {
+        auto [id, s, walk_raw] = stack.back();
+        stack.pop_back();
+        const Node node = store[id];
+        if (is_sum(id)) {
+            stack.push_back({node.b, node.op == '-' ? -s : s, walk_raw});
+            stack.push_back({node.a, s, walk_raw});
+        } else if (walk_raw) {
+            stack.push_back({done.at(id), s, false});
+        } else if (node.op == 'n') {
+            sum.constant += s * node.value;
+        } else if (node.op == '*' && is_constant(node.a)) {
+            sum.add(node.b, s * value(node.a));
+        } else if (node.op == '/' && is_constant(node.a) && value(node.a) != T(1)) {
+            sum.add(store.binary('/', store.constant(1), node.b), s * value(node.a));
+        } else {
+            sum.add(id, s);
+        }
+    }
+}
+
+// Множители цепочки * / с показателем exponent (всегда целым): x / y -> x ^ 1, y ^ -1
+void Rewriter::product_factors(Id root, T exponent, bool raw, Collected &product) {
+    std::vector<std::tuple<Id, T, bool>> stack = {{root, exponent, raw}};
+    while (!stack.empty()) {
+        auto [id, e, walk_raw] = stack.back();
+        stack.pop_back();
+        const Node node = store[id];
+        if (is_product(id)) {
+            stack.push_back({node.b, node.op == '/' ? -e : e, walk_raw});
+            stack.push_back({node.a, e, walk_raw});
+        } else if (walk_raw) {
+            stack.push_back({done.at(id), e, false});
+        } else if (node.op == 'n') {
+            if (e == T(1)) product.constant *= node.value;
+            else if (e == T(-1)) product.constant /= node.value;
+            else product.constant *= apply_binary('^', node.value, e);
+        } else if (is_negation(id)) {
+            if (!is_integer(e / T(2))) product.constant = -product.constant;
+            stack.push_back({node.b, e, false});
+        } else if (node.op == '^' && is_constant(node.b) && !is_constant(node.a)) {
+            product.add(node.a, e * value(node.b));
+        } else {
+            product.add(id, e);
+        }
+    }
+}
+
+
+//--------------//
+//---BUILDING---//
+//--------------//
+Rewriter::Id Rewriter::chain(char op, const std::vector<Id> &ids) {
+    Id result = ids[0];
+    for (size_t i = 1; i < ids.size(); ++i) result = store.binary(op, result, ids[i]);
+    return result;
+}
+
+// Слагаемое с коэффициентом k > 0: 1 / y -> k / y, иначе k * term
+static Rewriter::Id scale(NodeStore &store, Rewriter::Id term, T k) {
+    if (k == T(1)) return term;
+    const Node node = store[term];
+    if (node.op == '/' && store[node.a].op == 'n' && store[node.a].value == T(1))
+        return store.binary('/', store.constant(k), node.b);
+    return store.binary('*', store.constant(k), term);
+}
+
+// Сначала слагаемые с положительным коэффициентом, затем константа, затем вычитаемые
+Rewriter::Id Rewriter::build_sum(Collected &sum) {
+    std::vector<Id> added, subtracted;
+    for (const Term &term : sum.terms) {
+        if (term.k == T(0)) continue;
+        if (is_negative(term.k)) subtracted.push_back(scale(store, term.id, -term.k));
+        else added.push_back(scale(store, term.id, term.k));
+    }
+    if (added.empty() && subtracted.empty()) return store.constant(sum.constant);
+    if (is_negative(sum.constant)) subtracted.push_back(store.constant(-sum.constant));
+    else if (sum.constant != T(0)) added.push_back(store.constant(sum.constant));
+    Id result = added.empty() ? store.constant(0) : chain('+', added);
+    for (Id term : subtracted) result = store.binary('-', result, term);
+    return result;
+}
+
+// Коэффициент * (числитель / знаменатель); множители упорядочены по номеру узла,
+// так что x * y и y * x собираются в один узел
+Rewriter::Id Rewriter::build_product(Collected &product) {
+    if (product.constant == T(0)) return store.constant(0);
+    std::sort(product.terms.begin(), product.terms.end(), [](const Term &l, const Term &r) { return l.id < r.id; });
+    std::vector<Id> numerator, denominator;
+    for (const Term &term : product.terms) {
+        if (term.k == T(0)) continue;
+        T k = is_negative(term.k) ? -term.k : term.k;
+        Id factor = (k == T(1) ? term.id : store.binary('^', term.id, store.constant(k)));
+        (is_negative(term.k) ? denominator : numerator).push_back(factor);
+    }
+    if (numerator.empty() && denominator.empty()) return store.constant(product.constant);
+    Id body;
+    if (denominator.empty()) body = chain('*', numerator);
+    else body = store.binary('/', numerator.empty() ? store.constant(1) : chain('*', numerator), chain('*', denominator));
+    bool negative = is_negative(product.constant);
+    Id result = scale(store, body, negative ? -product.constant : product.constant);
+    return negative ? store.binary('-', store.constant(0), result) : result;
+}
+
+
+//-----------//
+//---OTHER---//
+//-----------//
+size_t Rewriter::tree_size(Id root) {
+    std::vector<std::pair<Id, bool>> stack = {{root, false}};
+    while (!stack.empty()) {
+        auto [id, visited] = stack.back();
+        stack.pop_back();
+        if (sizes.count(id)) continue;
+        const Node &node = store[id];
+        int n = arity(node.op);
+        if (!visited && n > 0) {
+            stack.push_back({id, true});
+            if (n == 2) stack.push_back({node.b, false});
+            stack.push_back({node.a, false});
+            continue;
+        }
+        size_t size = 1;
+        if (n >= 1) size += sizes[node.a];
+        if (n == 2) size += sizes[node.b];
+        sizes[id] = std::min(size, size_t(-1) / 2);
+    }
+    return sizes[root];
+}
+
+std::unique_ptr<Expression> canonicalize(const Expression &expr, size_t budget) {
+    NodeStore store;
+    Rewriter rewriter(store, budget);
+    NodeStore::Id id = rewriter.run(store.insert(expr));
+    if (rewriter.tree_size(id) >= count_nodes(expr)) return nullptr;
+    return store.extract(id);
+}
@@ -0,0 +1,68 @@
+#ifndef REWRITE_HPP
+#define REWRITE_HPP
+
+#include "Dag.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+constexpr size_t REWRITE_BUDGET = 1 << 20;
+constexpr int REWRITE_MAX_PASSES = 8;
+
+// Каноникализатор выражений в хранилище: проходы правил повторяются до неподвижной точки.
+//  - цепочки + - и * / разворачиваются целиком, константы в них сворачиваются в одну;
+//  - подобные слагаемые и множители собираются: 2 * x + 3 * x -> 5 * x, x * x -> x ^ 2;
+//  - x - x -> 0, x / x -> 1 (как и 0 * x -> 0, без учёта точек, где x не определён);
+//  - отрицание выносится наружу до ближайшей суммы: (0 - a) * b -> 0 - a * b;
+//  - ln(exp(a)) -> a.
+// budget ограничивает число новых узлов в хранилище; при превышении возвращается
+// результат последнего законченного прохода.
+class Rewriter {
+public:
+    using Id = NodeStore::Id;
+
+    explicit Rewriter(NodeStore &, size_t budget = REWRITE_BUDGET);
+    Id run(Id);
+    // размер дерева, которое даст extract (общий узел считается при каждом использовании)
+    size_t tree_size(Id);
+
+private:
+    struct Term {
+        Id id;
+        T k;  // коэффициент слагаемого или показатель степени множителя
+    };
+    struct Collected {
+        T constant = 0;
+        std::vector<Term> terms;
+        std::unordered_map<Id, size_t> index;
+
+        void add(Id, T);
+    };
+
+    NodeStore &store;
+    size_t budget, limit = 0;
+    std::unordered_map<Id, Id> done;
+    std::unordered_map<Id, size_t> sizes;
+
+    Id pass(Id);
+    Id rewrite(Id);
+    Id unary(char, Id);
+    Id power(Id, Id);
+    void sum_terms(Id, T sign, bool raw, Collected &);
+    void product_factors(Id, T exponent, bool raw, Collected &);
+    Id build_sum(Collected &);
+    Id build_product(Collected &);
+    Id chain(char, const std::vector<Id> &);
+
+    bool is_sum(Id) const;
+    bool is_product(Id) const;
+    bool is_negation(Id) const;
+    bool is_constant(Id) const;
+    T value(Id) const;
+};
+
+// Дерево, переписанное каноникализатором, или nullptr, если результат не меньше исходного:
+// тогда simplify() оставляет исходное дерево как есть
+std::unique_ptr<Expression> canonicalize(const Expression &, size_t budget = REWRITE_BUDGET);
+
+#endif
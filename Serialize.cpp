@@ -0,0 +1,248 @@
+#include "Serialize.hpp"
+#include "Dag.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(std::is_trivially_copyable_v<Instruction> && std::is_trivially_copyable_v<FileRoot>);
+
+// Смещения разделов файла; считаются одинаково при записи и при чтении
+struct Layout {
+    size_t constants, code, roots, offsets, strings, end;
+};
+
+static size_t align(size_t offset, size_t to) {
+    return (offset + to - 1) / to * to;
+}
+
+static Layout layout(const FileHeader &header) {
+    Layout l;
+    l.constants = align(sizeof(FileHeader), alignof(T) > 16 ? alignof(T) : 16);
+    l.code = align(l.constants + size_t(header.constants) * sizeof(T), alignof(Instruction));
+    l.roots = align(l.code + size_t(header.instructions) * sizeof(Instruction), alignof(FileRoot));
+    l.offsets = align(l.roots + size_t(header.roots) * sizeof(FileRoot), alignof(uint32_t));
+    l.strings = l.offsets + (size_t(header.strings) + 1) * sizeof(uint32_t);
+    l.end = l.strings + header.string_bytes;
+    return l;
+}
+
+
+//-----------//
+//---WRITE---//
+//-----------//
+void save(const std::string &path, const Program &program, const std::vector<uint32_t> &outputs,
+          const std::vector<std::string> &labels) {
+    if (outputs.size() != labels.size())
+        throw std::runtime_error("Every root needs a label");
+    // метки, совпадающие с именами переменных, ссылаются на ту же строку таблицы
+    std::vector<std::string> table = program.variables;
+    std::vector<uint32_t> label_index;
+    for (const std::string &label : labels) {
+        size_t i = std::find(table.begin(), table.end(), label) - table.begin();
+        if (i == table.size()) table.push_back(label);
+        label_index.push_back(i);
+    }
+
+    FileHeader header = {};
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.version = FILE_VERSION;
+    header.scalar_size = sizeof(T);
+    header.instructions = program.code.size();
+    header.constants = program.constants.size();
+    header.variables = program.variables.size();
+    header.roots = outputs.size();
+    header.strings = table.size();
+    for (const std::string &s : table) header.string_bytes += s.size();
+    Layout l = layout(header);
+
+    // буфер обнуляется заранее, чтобы выравнивание в структурах не попадало в файл мусором
+    std::vector<char> data(l.end, 0);
+    std::memcpy(data.data(), &header, sizeof(header));
+    for (size_t i = 0; i < program.constants.size(); ++i)
+        std::memcpy(data.data() + l.constants + i * sizeof(T), &program.constants[i], sizeof(T));
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        char *at = data.data() + l.code + i * sizeof(Instruction);
+        const Instruction &ins = program.code[i];
+        std::memcpy(at + offsetof(Instruction, op), &ins.op, sizeof(ins.op));
+        std::memcpy(at + offsetof(Instruction, a), &ins.a, sizeof(ins.a));
+        std::memcpy(at + offsetof(Instruction, b), &ins.b, sizeof(ins.b));
+    }
+    for (size_t k = 0; k < outputs.size(); ++k) {
+        FileRoot root = {outputs[k], label_index[k]};
+        std::memcpy(data.data() + l.roots + k * sizeof(FileRoot), &root, sizeof(root));
+    }
+    uint32_t offset = 0;
+    for (size_t i = 0; i <= table.size(); ++i) {
+        std::memcpy(data.data() + l.offsets + i * sizeof(uint32_t), &offset, sizeof(offset));
+        if (i == table.size()) break;
+        std::memcpy(data.data() + l.strings + offset, table[i].data(), table[i].size());
+        offset += table[i].size();
+    }
+
+    // запись во временный файл и переименование: читатель не увидит недописанный файл
+    std::string temporary = path + "." + std::to_string(getpid());
+    FILE *file = std::fopen(temporary.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error("Cannot open file: " + path);
+    bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    written = (std::fclose(file) == 0) && written;
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Cannot write file: " + path);
+    }
+}
+
+void save(const std::string &path, const Expression &expr, const std::vector<std::string> &by) {
+    NodeStore store;
+    std::vector<NodeStore::Id> roots = {store.insert(expr)};
+    std::vector<std::string> labels = {""};
+    for (const std::string &x : by) {
+        std::unique_ptr<Expression> der = expr.differentiate(x);
+        simplify(der);
+        roots.push_back(store.insert(*der));
+        labels.push_back(x);
+    }
+    std::vector<uint32_t> outputs;
+    Program program = store.compile(roots, outputs);
+    save(path, program, outputs, labels);
+}
+
+
+//----------//
+//---READ---//
+//----------//
+ExpressionFile::ExpressionFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open file: " + path);
+    struct stat info;
+    if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(FileHeader)) {
+        close(fd);
+        throw std::runtime_error("Not an expression file: " + path);
+    }
+    void *p = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        throw std::runtime_error("Cannot map file: " + path);
+    mapped = static_cast<const char *>(p);
+    mapped_size = info.st_size;
+    try {
+        validate();
+    } catch (const std::runtime_error &error) {
+        munmap(const_cast<char *>(mapped), mapped_size);
+        throw std::runtime_error(std::string(error.what()) + ": " + path);
+    }
+}
+ExpressionFile::~ExpressionFile() {
+    munmap(const_cast<char *>(mapped), mapped_size);
+}
+
+// Один линейный проход: после него код можно выполнять, не проверяя номера
+void ExpressionFile::validate() {
+    const FileHeader *h = reinterpret_cast<const FileHeader *>(mapped);
+    if (std::memcmp(h->magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+        throw std::runtime_error("Not an expression file");
+    if (h->version != FILE_VERSION)
+        throw std::runtime_error("Unsupported expression file version " + std::to_string(h->version));
+    if (h->scalar_size != sizeof(T))
+        throw std::runtime_error("Expression file was written with another number format");
+    if (h->instructions == 0 || h->variables > h->strings)
+        throw std::runtime_error("Corrupted expression file");
+    Layout l = layout(*h);
+    if (l.end != mapped_size)
+        throw std::runtime_error("Corrupted expression file");
+
+    header = h;
+    constants = reinterpret_cast<const T *>(mapped + l.constants);
+    code = reinterpret_cast<const Instruction *>(mapped + l.code);
+    root_table = reinterpret_cast<const FileRoot *>(mapped + l.roots);
+    offsets = reinterpret_cast<const uint32_t *>(mapped + l.offsets);
+    strings = mapped + l.strings;
+
+    for (uint32_t i = 0; i < h->instructions; ++i) {
+        const Instruction &ins = code[i];
+        int n = arity(ins.op);
+        bool valid = std::string_view("nvscle+-*/^").find(ins.op) != std::string_view::npos;
+        if (ins.op == 'n') valid = valid && ins.a < h->constants;
+        if (ins.op == 'v') valid = valid && ins.a < h->variables;
+        if (n >= 1) valid = valid && ins.a < i;
+        if (n == 2) valid = valid && ins.b < i;
+        if (!valid)
+            throw std::runtime_error("Corrupted expression file");
+    }
+    for (uint32_t k = 0; k < h->roots; ++k)
+        if (root_table[k].output >= h->instructions || root_table[k].label >= h->strings)
+            throw std::runtime_error("Corrupted expression file");
+    if (offsets[0] != 0 || offsets[h->strings] != h->string_bytes)
+        throw std::runtime_error("Corrupted expression file");
+    for (uint32_t i = 0; i < h->strings; ++i)
+        if (offsets[i] > offsets[i + 1])
+            throw std::runtime_error("Corrupted expression file");
+}
+
+std::string_view ExpressionFile::string(uint32_t i) const {
+    return std::string_view(strings + offsets[i], offsets[i + 1] - offsets[i]);
+}
+
+size_t ExpressionFile::size() const {
+    return header->instructions;
+}
+size_t ExpressionFile::roots() const {
+    return header->roots;
+}
+std::string_view ExpressionFile::label(size_t root) const {
+    return string(root_table[root].label);
+}
+size_t ExpressionFile::variables() const {
+    return header->variables;
+}
+std::string_view ExpressionFile::variable(size_t slot) const {
+    return string(slot);
+}
+size_t ExpressionFile::slot(std::string_view name) const {
+    for (size_t i = 0; i < header->variables; ++i)
+        if (variable(i) == name) return i;
+    return -1;
+}
+
+void ExpressionFile::evaluate(const T *slots, T *registers, T *out) const {
+    run(code, header->instructions, constants, slots, registers);
+    for (size_t k = 0; k < header->roots; ++k) out[k] = registers[root_table[k].output];
+}
+std::vector<T> ExpressionFile::evaluate(const std::map<std::string, T> &x) const {
+    std::vector<T> slots(header->variables), out(header->roots);
+    for (size_t i = 0; i < slots.size(); ++i) {
+        auto it = x.find(std::string(variable(i)));
+        slots[i] = (it != x.end()) ? it->second : T{};
+    }
+    thread_local std::vector<T> registers;
+    if (registers.size() < size())
+        registers.resize(size());
+    evaluate(slots.data(), registers.data(), out.data());
+    return out;
+}
+
+// Код уже в топологическом порядке, так что узлы хранилища строятся одним проходом
+std::unique_ptr<Expression> ExpressionFile::expression(size_t root) const {
+    NodeStore store;
+    std::vector<NodeStore::Id> ids(size());
+    for (uint32_t i = 0; i < size(); ++i) {
+        const Instruction &ins = code[i];
+        switch (ins.op) {
+            case 'n': ids[i] = store.constant(constants[ins.a]); break;
+            case 'v': ids[i] = store.variable(std::string(variable(ins.a))); break;
+            case 's': case 'c': case 'l': case 'e':
+                ids[i] = store.unary(ins.op, ids[ins.a]); break;
+            default:
+                ids[i] = store.binary(ins.op, ids[ins.a], ids[ins.b]);
+        }
+    }
+    return store.extract(ids[root_table[root].output]);
+}
@@ -0,0 +1,76 @@
+#ifndef SERIALIZE_HPP
+#define SERIALIZE_HPP
+
+#include "Bytecode.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Двоичный формат набора выражений (версия 1). Порядок байтов и представление T — машинные,
+// поэтому файл проверяется по заголовку и читается только на той же платформе.
+//     FileHeader
+//     T[constants]                 — с границы 16 байт
+//     Instruction[instructions]    — код Program: общие подвыражения хранятся один раз
+//     FileRoot[roots]              — регистр корня и его метка
+//     uint32_t[strings + 1]        — смещения строк в таблице
+//     char[string_bytes]           — таблица строк: сначала имена переменных по слотам, затем прочие метки
+// Файл отображается в память, и вычисление идёт прямо по отображённым массивам без разбора и копирования.
+constexpr char FILE_MAGIC[8] = {'D', 'I', 'F', 'F', 'E', 'X', 'P', 'R'};
+constexpr uint32_t FILE_VERSION = 1;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t scalar_size;
+    uint32_t instructions, constants, variables, roots;
+    uint32_t strings, string_bytes;
+};
+
+struct FileRoot {
+    uint32_t output;
+    uint32_t label;
+};
+
+// Корни набора: метка "" — само выражение, имя переменной — производная по ней
+void save(const std::string &path, const Program &, const std::vector<uint32_t> &outputs,
+          const std::vector<std::string> &labels);
+// Выражение и его упрощённые производные по by в одном файле
+void save(const std::string &path, const Expression &, const std::vector<std::string> &by = {});
+
+// Набор выражений из файла, отображённого в память. Ошибка чтения или повреждённый файл — исключение.
+class ExpressionFile {
+public:
+    explicit ExpressionFile(const std::string &path);
+    ~ExpressionFile();
+    ExpressionFile(const ExpressionFile &) = delete;
+    ExpressionFile& operator=(const ExpressionFile &) = delete;
+
+    size_t size() const;
+    size_t roots() const;
+    std::string_view label(size_t root) const;
+    size_t variables() const;
+    std::string_view variable(size_t slot) const;
+    // номер слота переменной или -1, если её нет
+    size_t slot(std::string_view) const;
+
+    // Все корни за один проход кода; registers вмещает size() значений, out — roots()
+    void evaluate(const T *slots, T *registers, T *out) const;
+    std::vector<T> evaluate(const std::map<std::string, T> & = {}) const;
+    // дерево корня для печати и дальнейших преобразований
+    std::unique_ptr<Expression> expression(size_t root) const;
+
+private:
+    const char *mapped = nullptr;
+    size_t mapped_size = 0;
+    const FileHeader *header = nullptr;
+    const T *constants = nullptr;
+    const Instruction *code = nullptr;
+    const FileRoot *root_table = nullptr;
+    const uint32_t *offsets = nullptr;
+    const char *strings = nullptr;
+
+    std::string_view string(uint32_t) const;
+    void validate();
+};
+
+#endif
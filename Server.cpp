@@ -0,0 +1,190 @@
+#include "Server.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+constexpr size_t SOCKET_BLOCK = 1 << 16;
+// Строка запроса без перевода длиннее этого — клиент отключается
+constexpr size_t SOCKET_LINE_LIMIT = 1 << 20;
+// Пока неотправленных ответов больше этого, запросы клиента не читаются
+constexpr size_t SOCKET_OUTPUT_LIMIT = 1 << 20;
+
+
+//------------//
+//---SERVER---//
+//------------//
+Server::Server(size_t capacity) : runner(capacity) {
+    latencies.reserve(LATENCY_WINDOW);
+}
+
+bool Server::handle(std::string_view line, std::string &out) {
+    if (line == "quit") return false;
+    if (line == "stats") {
+        out += stats();
+        return true;
+    }
+    auto start = std::chrono::steady_clock::now();
+    runner.run(line, out);
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    if (latencies.size() < LATENCY_WINDOW) latencies.push_back(ns);
+    else latencies[requests % LATENCY_WINDOW] = ns;
+    ++requests;
+    return true;
+}
+
+// Перцентили — по ближайшему рангу среди последних LATENCY_WINDOW заданий
+std::string Server::stats() const {
+    std::vector<uint64_t> sorted = latencies;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&](double p) -> uint64_t {
+        if (sorted.empty()) return 0;
+        size_t rank = size_t(p * sorted.size() + 0.999999);
+        return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+    };
+    const JobRunner::CacheStats &cache = runner.stats();
+    std::string out = "{\"requests\":" + std::to_string(requests) + ",\"hits\":" + std::to_string(cache.hits) +
+                      ",\"misses\":" + std::to_string(cache.misses) + ",\"evictions\":" + std::to_string(cache.evictions) +
+                      ",\"entries\":" + std::to_string(runner.size()) + ",\"capacity\":" + std::to_string(runner.capacity()) +
+                      ",\"latency_ns\":{\"p50\":" + std::to_string(percentile(0.5)) + ",\"p90\":" +
+                      std::to_string(percentile(0.9)) + ",\"p99\":" + std::to_string(percentile(0.99)) +
+                      ",\"max\":" + std::to_string(sorted.empty() ? 0 : sorted.back()) + "}}";
+    return out;
+}
+
+
+//-----------//
+//---LOOPS---//
+//-----------//
+// Ответ сбрасывается после каждой строки: клиент ждёт его, прежде чем послать следующую
+static int serve_stdin(Server &server) {
+    LineReader reader("");
+    std::string_view line;
+    std::string out;
+    while (reader.next(line)) {
+        out.clear();
+        bool more = server.handle(line, out);
+        out += '\n';
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+        if (!more) break;
+    }
+    return 0;
+}
+
+// Клиент неблокирующий: прочитанное копится в input, ответы — в output до готовности сокета к записи
+struct Client {
+    std::string input, output;
+    bool closing = false;
+};
+
+// Полные строки выполняются по порядку, пока очередь ответов не превысила SOCKET_OUTPUT_LIMIT:
+// остальные ждут, пока клиент прочтёт ответы. false — строка без перевода длиннее SOCKET_LINE_LIMIT
+static bool process(Server &server, Client &client) {
+    size_t begin = 0, nl;
+    while (!client.closing && client.output.size() < SOCKET_OUTPUT_LIMIT &&
+           (nl = client.input.find('\n', begin)) != std::string::npos) {
+        std::string_view line(client.input.data() + begin, nl - begin);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        client.closing = !server.handle(line, client.output);
+        client.output += '\n';
+        begin = nl + 1;
+    }
+    client.input.erase(0, begin);
+    return client.input.size() <= SOCKET_LINE_LIMIT || client.input.find('\n') != std::string::npos;
+}
+
+// Отправляет сколько примет сокет; false — соединение разорвано
+static bool flush(int fd, Client &client) {
+    size_t sent = 0;
+    while (sent < client.output.size()) {
+        ssize_t n = send(fd, client.output.data() + sent, client.output.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n <= 0) return false;
+        sent += n;
+    }
+    client.output.erase(0, sent);
+    return true;
+}
+
+// Один поток обслуживает всех клиентов через poll. Клиент, который не читает ответы, не блокирует
+// остальных: его ответы ждут POLLOUT, а новые строки не читаются, пока очередь не разойдётся
+static int serve_socket(Server &server, const std::string &path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) throw std::runtime_error("Socket path is too long: " + path);
+    std::strcpy(address.sun_path, path.c_str());
+    // удаляется только старый сокет: обычный файл по этому пути остаётся на месте
+    struct stat existing;
+    if (lstat(path.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) throw std::runtime_error("Cannot listen on socket: " + path);
+        unlink(path.c_str());
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) throw std::runtime_error("Cannot create socket");
+    if (bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(listener, 64) < 0) {
+        close(listener);
+        throw std::runtime_error("Cannot listen on socket: " + path);
+    }
+    std::vector<pollfd> fds = {{listener, POLLIN, 0}};
+    std::vector<Client> clients(1);
+    std::vector<char> block(SOCKET_BLOCK);
+    while (true) {
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            int client = accept(listener, nullptr, nullptr);
+            if (client >= 0) {
+                fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+                fds.push_back({client, POLLIN, 0});
+                clients.emplace_back();
+            }
+        }
+        for (size_t i = 1; i < fds.size(); ++i) {
+            if (!fds[i].revents) continue;
+            Client &client = clients[i];
+            bool open = !(fds[i].revents & (POLLERR | POLLNVAL));
+            if (open && (fds[i].revents & (POLLIN | POLLHUP))) {
+                ssize_t got = read(fds[i].fd, block.data(), block.size());
+                if (got > 0) client.input.append(block.data(), got);
+                else if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) open = false;
+            }
+            // пока ответы расходятся сразу, выполняются и строки, отложенные из-за полной очереди
+            while (open) {
+                open = process(server, client) && flush(fds[i].fd, client);
+                if (client.closing || !client.output.empty() || client.input.find('\n') == std::string::npos) break;
+            }
+            if (open && client.closing && client.output.empty()) open = false;
+            if (!open) {
+                close(fds[i].fd);
+                fds.erase(fds.begin() + i);
+                clients.erase(clients.begin() + i);
+                --i;
+                continue;
+            }
+            fds[i].events = (client.closing || client.output.size() >= SOCKET_OUTPUT_LIMIT ? 0 : POLLIN) |
+                            (client.output.empty() ? 0 : POLLOUT);
+        }
+    }
+    close(listener);
+    unlink(path.c_str());
+    return 1;
+}
+
+int run_server(const std::string &socket_path, size_t capacity) {
+    Server server(capacity);
+    if (socket_path.empty()) return serve_stdin(server);
+    return serve_socket(server, socket_path);
+}
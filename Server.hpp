@@ -0,0 +1,33 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include "Stream.hpp"
+
+#include <cstdint>
+
+// Сколько последних задержек хранится для перцентилей
+constexpr size_t LATENCY_WINDOW = 1 << 16;
+
+// Долгоживущий режим --serve: строка запроса — строка задания, как в --batch, или команда
+//     stats — счётчики кэша и перцентили задержки одной строкой JSON
+//     quit  — закрыть соединение
+// Ответ — ровно одна строка на каждую строку запроса. Кэш общий для всех клиентов.
+class Server {
+public:
+    explicit Server(size_t capacity = 4096);
+    // дописывает в out ответ без перевода строки; false — клиент закрывает соединение
+    bool handle(std::string_view line, std::string &out);
+    std::string stats() const;
+
+private:
+    JobRunner runner;
+    // кольцо последних LATENCY_WINDOW задержек заданий в наносекундах
+    std::vector<uint64_t> latencies;
+    size_t requests = 0;
+};
+
+// Запросы из stdin (socket_path пуст) или от клиентов unix-сокета socket_path.
+// Клиенты обслуживаются одним потоком через poll, поэтому кэш не требует блокировок.
+int run_server(const std::string &socket_path, size_t capacity = 4096);
+
+#endif
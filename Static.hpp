@@ -0,0 +1,355 @@
+#ifndef STATIC_HPP
+#define STATIC_HPP
+
+#include "Expression.hpp"
+#include "Parser.hpp"
+
+#include <cstddef>
+#include <string_view>
+
+// Выражения, известные при сборке: строка разбирается на этапе компиляции (тем же разбором,
+// что и Expression::create), а дерево становится типом из Constant/Variable/Unary/Binary.
+// Производная — преобразование типа по тем же правилам, что и differentiate, так что
+//     using F = compiletime::Formula<"sin(x) * y">;
+//     F::evaluate(x, y);                      // значения переменных в порядке первого появления
+//     F::derivative<"x">::evaluate(x, y);
+// сводятся к прямой арифметике без разбора, кучи и виртуальных вызовов, а результаты
+// совпадают с Expression::create(...)->differentiate(...)->evaluate(...) бит в бит.
+// Ошибка в строке — ошибка компиляции.
+namespace compiletime {
+
+//-----------//
+//---TYPES---//
+//-----------//
+template <T V>
+struct Constant {
+    static T evaluate(const T *) { return V; }
+    static std::unique_ptr<Expression> expression(const std::string_view *) {
+        return std::make_unique<::Constant>(V);
+    }
+};
+
+template <size_t Slot>
+struct Variable {
+    static T evaluate(const T *slots) { return slots[Slot]; }
+    static std::unique_ptr<Expression> expression(const std::string_view *names) {
+        return std::make_unique<::Variable>(std::string(names[Slot]));
+    }
+};
+
+template <char Op, typename A>
+struct Unary {
+    static T evaluate(const T *slots) { return apply_unary(Op, A::evaluate(slots)); }
+    static std::unique_ptr<Expression> expression(const std::string_view *names) {
+        return std::make_unique<::Unary>(Op, A::expression(names));
+    }
+};
+
+template <char Op, typename A, typename B>
+struct Binary {
+    static T evaluate(const T *slots) { return apply_binary(Op, A::evaluate(slots), B::evaluate(slots)); }
+    static std::unique_ptr<Expression> expression(const std::string_view *names) {
+        return std::make_unique<::Binary>(Op, A::expression(names), B::expression(names));
+    }
+};
+
+
+//---------------------//
+//---DIFFERENTIATION---//
+//---------------------//
+// Правила Unary::differentiate и Binary::differentiate, узел в узел
+template <typename E, size_t X>
+struct Derivative;
+
+template <typename E, size_t X>
+using derivative_t = typename Derivative<E, X>::type;
+
+template <T V, size_t X>
+struct Derivative<Constant<V>, X> {
+    using type = Constant<T(0)>;
+};
+template <size_t Slot, size_t X>
+struct Derivative<Variable<Slot>, X> {
+    using type = Constant<T(Slot == X ? 1 : 0)>;
+};
+template <typename A, size_t X>
+struct Derivative<Unary<'s', A>, X> {
+    using type = Binary<'*', Unary<'c', A>, derivative_t<A, X>>;
+};
+template <typename A, size_t X>
+struct Derivative<Unary<'c', A>, X> {
+    using type = Binary<'*', Binary<'-', Constant<T(0)>, Unary<'s', A>>, derivative_t<A, X>>;
+};
+template <typename A, size_t X>
+struct Derivative<Unary<'l', A>, X> {
+    using type = Binary<'/', derivative_t<A, X>, A>;
+};
+template <typename A, size_t X>
+struct Derivative<Unary<'e', A>, X> {
+    using type = Binary<'*', Unary<'e', A>, derivative_t<A, X>>;
+};
+template <typename A, typename B, size_t X>
+struct Derivative<Binary<'+', A, B>, X> {
+    using type = Binary<'+', derivative_t<A, X>, derivative_t<B, X>>;
+};
+template <typename A, typename B, size_t X>
+struct Derivative<Binary<'-', A, B>, X> {
+    using type = Binary<'-', derivative_t<A, X>, derivative_t<B, X>>;
+};
+template <typename A, typename B, size_t X>
+struct Derivative<Binary<'*', A, B>, X> {
+    using type = Binary<'+', Binary<'*', derivative_t<A, X>, B>, Binary<'*', A, derivative_t<B, X>>>;
+};
+template <typename A, typename B, size_t X>
+struct Derivative<Binary<'/', A, B>, X> {
+    using type = Binary<'/',
+        Binary<'-', Binary<'*', derivative_t<A, X>, B>, Binary<'*', A, derivative_t<B, X>>>,
+        Binary<'^', B, Constant<T(2)>>>;
+};
+template <typename A, typename B, size_t X>
+struct Derivative<Binary<'^', A, B>, X> {
+    using type = derivative_t<Unary<'e', Binary<'*', B, Unary<'l', A>>>, X>;
+};
+
+
+//-------------//
+//---PARSING---//
+//-------------//
+template <size_t N>
+struct Literal {
+    char text[N] = {};
+
+    consteval Literal(const char (&source)[N]) {
+        for (size_t i = 0; i < N; ++i) text[i] = source[i];
+    }
+    constexpr std::string_view view() const {
+        return std::string_view(text, N - 1);
+    }
+};
+
+// Плоское дерево разбора: kind 'n' — константа value, 'v' — переменная slot,
+// 'u' — унарная op над a, 'b' — бинарная op над a и b
+struct Node {
+    char kind = 0, op = 0;
+    size_t a = 0, b = 0, slot = 0;
+    T value = 0;
+};
+
+// Узлов не больше 2N + 1: каждый символ даёт не больше двух узлов (унарный минус — Binary и Constant(0))
+template <size_t N>
+struct Tree {
+    Node nodes[2 * N + 1] = {};
+    size_t size = 0, root = 0;
+    // имена переменных в порядке первого появления: начало и длина в исходной строке
+    size_t name_begin[N] = {}, name_length[N] = {};
+    size_t names = 0;
+};
+
+// Разбор Parser/Tokenizer на этапе компиляции
+template <size_t N>
+class Parser {
+public:
+    consteval Parser(std::string_view source) : source(source) {
+        advance();
+    }
+
+    consteval Tree<N> parse() {
+        if (type == '\0') {
+            tree.root = add({'n'});
+        } else {
+            tree.root = parse_expression(1);
+            if (type == ')') throw "Unmatched ')'";
+            if (type != '\0') throw "Unexpected token";
+        }
+        return tree;
+    }
+
+private:
+    std::string_view source, text;
+    size_t pos = 0;
+    char type = 0;
+    Tree<N> tree;
+
+    static constexpr bool is_digit(char c) {
+        return ('0' <= c && c <= '9') || c == '.' || c == ',';
+    }
+    static constexpr bool is_name_char(char c) {
+        return ('A' <= c && c <= 'Z') || ('a' <= c && c <= 'z') || ('0' <= c && c <= '9') || c == '_';
+    }
+
+    consteval void advance() {
+        while (pos < source.length() && (source[pos] == ' ' || source[pos] == '\t' || source[pos] == '\n' || source[pos] == '\r'))
+            ++pos;
+        size_t start = pos;
+        if (pos == source.length()) {
+            type = '\0';
+            return;
+        }
+        char c = source[pos];
+        if (is_digit(c)) {
+            int dot_count = 0, digit_count = 0;
+            for (; pos < source.length() && is_digit(source[pos]); ++pos) {
+                if (source[pos] == '.' || source[pos] == ',') ++dot_count;
+                else ++digit_count;
+            }
+            if (pos < source.length() && source[pos] == 'i' && (pos + 1 == source.length() || !is_name_char(source[pos + 1])))
+                ++pos;
+            if (dot_count > 1 || digit_count == 0) throw "Invalid number";
+            type = 'n';
+        } else if (is_name_char(c)) {
+            while (pos < source.length() && is_name_char(source[pos])) ++pos;
+            type = 'a';
+        } else if (c == '(' || c == ')' || precedence(c) > 0) {
+            ++pos;
+            type = c;
+        } else {
+            throw "Unexpected symbol";
+        }
+        text = source.substr(start, pos - start);
+    }
+
+    consteval size_t add(Node node) {
+        tree.nodes[tree.size] = node;
+        return tree.size++;
+    }
+
+    consteval size_t variable(std::string_view name) {
+        size_t slot = 0;
+        while (slot < tree.names && source.substr(tree.name_begin[slot], tree.name_length[slot]) != name) ++slot;
+        if (slot == tree.names) {
+            tree.name_begin[slot] = name.data() - source.data();
+            tree.name_length[slot] = name.length();
+            ++tree.names;
+        }
+        Node node = {'v'};
+        node.slot = slot;
+        return add(node);
+    }
+
+    consteval size_t parse_expression(int min_prec) {
+        size_t left = parse_primary(min_prec);
+        while (true) {
+            char op = type;
+            int prec = precedence(op);
+            if (prec == 0 || prec < min_prec) break;
+            advance();
+            size_t right = parse_expression(prec + 1);
+            left = add({'b', op, left, right});
+        }
+        return left;
+    }
+
+    consteval size_t parse_primary(int min_prec) {
+        char token = type;
+        std::string_view token_text = text;
+        if (token == '\0') throw "Unexpected end of expression";
+        advance();
+        if (token == 'n') {
+            Node node = {'n'};
+            node.value = to_number<T>(token_text);
+            return add(node);
+        }
+        if (token == 'a') {
+            for (auto [op, name] : {std::pair<char, std::string_view>{'s', "sin"}, {'c', "cos"}, {'l', "ln"}, {'e', "exp"}}) {
+                if (token_text != name) continue;
+                if (type != '(') throw "Expected a '(...)' after a function name";
+                advance();
+                size_t argument = parse_expression(1);
+                if (type != ')') throw "Expected a ')'";
+                advance();
+                return add({'u', op, argument});
+            }
+            return variable(token_text);
+        }
+        if (token == '(') {
+            size_t inner = parse_expression(1);
+            if (type != ')') throw "Expected a ')'";
+            advance();
+            return inner;
+        }
+        if (token == '-' || token == '+') {
+            size_t zero = add({'n'});
+            size_t operand = parse_expression(min_prec > 2 ? min_prec : 2);
+            return add({'b', token, zero, operand});
+        }
+        throw "Unexpected token";
+    }
+};
+
+template <Literal Source>
+constexpr Tree<sizeof(Source.text)> parsed = Parser<sizeof(Source.text)>(Source.view()).parse();
+
+// Плоское дерево -> тип
+template <const auto &Parsed, size_t I, char Kind = Parsed.nodes[I].kind>
+struct Build;
+
+template <const auto &Parsed, size_t I>
+struct Build<Parsed, I, 'n'> {
+    using type = Constant<Parsed.nodes[I].value>;
+};
+template <const auto &Parsed, size_t I>
+struct Build<Parsed, I, 'v'> {
+    using type = Variable<Parsed.nodes[I].slot>;
+};
+template <const auto &Parsed, size_t I>
+struct Build<Parsed, I, 'u'> {
+    using type = Unary<Parsed.nodes[I].op, typename Build<Parsed, Parsed.nodes[I].a>::type>;
+};
+template <const auto &Parsed, size_t I>
+struct Build<Parsed, I, 'b'> {
+    using type = Binary<Parsed.nodes[I].op, typename Build<Parsed, Parsed.nodes[I].a>::type,
+                        typename Build<Parsed, Parsed.nodes[I].b>::type>;
+};
+
+
+//-------------//
+//---FORMULA---//
+//-------------//
+template <Literal Source, typename E = typename Build<parsed<Source>, parsed<Source>.root>::type>
+struct Formula {
+    using type = E;
+
+    static constexpr size_t variables = parsed<Source>.names;
+
+    static constexpr std::string_view variable(size_t slot) {
+        return Source.view().substr(parsed<Source>.name_begin[slot], parsed<Source>.name_length[slot]);
+    }
+    // номер переменной или variables, если её нет
+    static constexpr size_t slot(std::string_view name) {
+        size_t i = 0;
+        while (i < variables && variable(i) != name) ++i;
+        return i;
+    }
+
+    static T evaluate(const T *slots) {
+        return E::evaluate(slots);
+    }
+    template <typename... Args>
+        requires (sizeof...(Args) == variables)
+    static T evaluate(Args... values) {
+        const T slots[sizeof...(Args) + 1] = {T(values)...};
+        return E::evaluate(slots);
+    }
+    static T evaluate(const std::map<std::string, T> &x) {
+        T slots[variables + 1] = {};
+        for (size_t i = 0; i < variables; ++i) {
+            auto it = x.find(std::string(variable(i)));
+            if (it != x.end()) slots[i] = it->second;
+        }
+        return E::evaluate(slots);
+    }
+
+    template <Literal X>
+    using derivative = Formula<Source, derivative_t<E, slot(X.view())>>;
+
+    // то же дерево во время выполнения (для печати и сверки)
+    static std::unique_ptr<Expression> expression() {
+        std::string_view names[variables + 1];
+        for (size_t i = 0; i < variables; ++i) names[i] = variable(i);
+        return E::expression(names);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,50 @@
+#include "Stats.hpp"
+
+static const char *PHASE_NAMES[PHASES] = {"parse", "compile", "evaluate", "differentiate", "simplify", "to_string"};
+static const char *NODE_NAMES[4] = {"constant", "variable", "unary", "binary"};
+
+Statistics& statistics() {
+    static Statistics instance;
+    return instance;
+}
+
+void Statistics::reset() {
+    for (Counter *c : {&allocations, &deallocations, &clones, &evaluate_depth, &differentiate_depth, &simplify_calls,
+                       &nodes_before_simplify, &nodes_after_simplify, &depth_before_simplify, &depth_after_simplify})
+        c->value = 0;
+    for (Counter &c : evaluate_calls) c.value = 0;
+    for (int p = 0; p < PHASES; ++p) phase_calls[p].value = phase_ns[p].value = 0;
+}
+
+std::string Statistics::json() const {
+    auto field = [](const char *name, size_t value) {
+        return std::string("\"") + name + "\":" + std::to_string(value);
+    };
+    std::string out = "{\"instrumented\":true,";
+    out += field("allocations", allocations.get()) + "," + field("deallocations", deallocations.get()) + ",";
+    out += field("clones", clones.get()) + ",\"evaluate_calls\":{";
+    for (int i = 0; i < 4; ++i) out += (i ? "," : "") + field(NODE_NAMES[i], evaluate_calls[i].get());
+    out += "},\"max_depth\":{" + field("evaluate", evaluate_depth.get()) + "," +
+           field("differentiate", differentiate_depth.get()) + "},";
+    out += "\"simplify\":{" + field("calls", simplify_calls.get()) + "," +
+           field("nodes_before", nodes_before_simplify.get()) + "," + field("nodes_after", nodes_after_simplify.get()) + "," +
+           field("depth_before", depth_before_simplify.get()) + "," + field("depth_after", depth_after_simplify.get()) + "},";
+    out += "\"phases\":{";
+    for (int p = 0; p < PHASES; ++p) {
+        out += std::string(p ? "," : "") + "\"" + PHASE_NAMES[p] + "\":{" + field("calls", phase_calls[p].get()) + "," +
+               field("ns", phase_ns[p].get()) + "}";
+    }
+    return out + "}}";
+}
+
+std::string stats_json() {
+    if constexpr (STATS_ENABLED) return statistics().json();
+    return "{\"instrumented\":false}";
+}
+
+PhaseTimer::PhaseTimer(Phase phase) : phase(phase), start(std::chrono::steady_clock::now()) {}
+PhaseTimer::~PhaseTimer() {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    statistics().phase_calls[phase].add();
+    statistics().phase_ns[phase].add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
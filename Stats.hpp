@@ -0,0 +1,61 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+// Счётчики горячих путей включаются сборкой с -DDIFFERENTIATOR_STATS (make STATS=1).
+// Без этого флага STATS(...) раскрывается в пустоту и код счётчиков не компилируется вовсе.
+#ifdef DIFFERENTIATOR_STATS
+#define STATS(...) __VA_ARGS__
+constexpr bool STATS_ENABLED = true;
+#else
+#define STATS(...)
+constexpr bool STATS_ENABLED = false;
+#endif
+
+enum Phase { PARSE, COMPILE, EVALUATE, DIFFERENTIATE, SIMPLIFY, TO_STRING, PHASES };
+
+// Все счётчики процесса; обновляются из любых потоков
+struct Statistics {
+    struct Counter {
+        std::atomic<size_t> value = 0;
+        void add(size_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+        void max(size_t n) {
+            size_t current = value.load(std::memory_order_relaxed);
+            while (current < n && !value.compare_exchange_weak(current, n, std::memory_order_relaxed)) {}
+        }
+        size_t get() const { return value.load(std::memory_order_relaxed); }
+    };
+
+    Counter allocations, deallocations, clones;
+    // вызовы evaluate по типу узла: Constant, Variable, Unary, Binary
+    Counter evaluate_calls[4];
+    Counter evaluate_depth, differentiate_depth;
+    Counter simplify_calls, nodes_before_simplify, nodes_after_simplify, depth_before_simplify, depth_after_simplify;
+    Counter phase_calls[PHASES], phase_ns[PHASES];
+
+    void reset();
+    std::string json() const;
+};
+
+Statistics& statistics();
+// {"instrumented":false} при сборке без счётчиков
+std::string stats_json();
+
+// Время от создания до разрушения добавляется к фазе
+class PhaseTimer {
+public:
+    explicit PhaseTimer(Phase);
+    ~PhaseTimer();
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer& operator=(const PhaseTimer &) = delete;
+
+private:
+    Phase phase;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,325 @@
+#include "Stream.hpp"
+#include "Taylor.hpp"
+#include "Executor.hpp"
+#include "Stats.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr size_t READ_BLOCK = 1 << 20;
+constexpr size_t OUTPUT_BLOCK = 1 << 16;
+constexpr size_t PARALLEL_LINES = 1 << 14;
+
+
+//----------------//
+//---LINEREADER---//
+//----------------//
+LineReader::LineReader(const std::string &path) {
+    if (path.empty() || path == "-") {
+        fd = 0;
+    } else {
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Cannot open file: " + path);
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            void *p = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                mapped = static_cast<const char *>(p);
+                mapped_size = info.st_size;
+                madvise(p, mapped_size, MADV_SEQUENTIAL);
+            }
+        }
+    }
+    if (!mapped) buffer.resize(READ_BLOCK);
+}
+LineReader::~LineReader() {
+    if (mapped) munmap(const_cast<char *>(mapped), mapped_size);
+    if (fd > 0) close(fd);
+}
+
+static std::string_view trim_line(const char *begin, const char *end) {
+    if (end > begin && end[-1] == '\r') --end;
+    return std::string_view(begin, end - begin);
+}
+
+bool LineReader::next(std::string_view &line) {
+    if (mapped) {
+        if (offset >= mapped_size) return false;
+        const char *begin = mapped + offset;
+        const char *nl = static_cast<const char *>(std::memchr(begin, '\n', mapped_size - offset));
+        const char *end = nl ? nl : mapped + mapped_size;
+        offset = end - mapped + 1;
+        line = trim_line(begin, end);
+        return true;
+    }
+    while (true) {
+        const char *nl = static_cast<const char *>(std::memchr(buffer.data() + begin, '\n', end - begin));
+        if (nl) {
+            line = trim_line(buffer.data() + begin, nl);
+            begin = nl - buffer.data() + 1;
+            return true;
+        }
+        if (eof) {
+            if (begin == end) return false;
+            line = trim_line(buffer.data() + begin, buffer.data() + end);
+            begin = end;
+            return true;
+        }
+        // хвост незаконченной строки переносится в начало буфера; длинная строка увеличивает буфер
+        std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+        if (end == buffer.size()) buffer.resize(buffer.size() * 2);
+        ssize_t got = read(fd, buffer.data() + end, buffer.size() - end);
+        if (got <= 0) eof = true;
+        else end += got;
+    }
+}
+
+
+//------------------//
+//---OUTPUTBUFFER---//
+//------------------//
+OutputBuffer::~OutputBuffer() {
+    flush();
+}
+void OutputBuffer::write(std::string_view s) {
+    data.append(s);
+    if (data.size() >= OUTPUT_BLOCK) flush();
+}
+void OutputBuffer::flush() {
+    std::fwrite(data.data(), 1, data.size(), stdout);
+    std::fflush(stdout);
+    data.clear();
+}
+
+
+//---------------//
+//---JOBRUNNER---//
+//---------------//
+template <typename N>
+static void append_value(std::string &out, N value) {
+    if constexpr (std::is_same_v<N, long double>) {
+        char buf[64];
+        int n = std::snprintf(buf, sizeof(buf), "%Lg", value);
+        out.append(buf, n);
+    } else {
+        std::ostringstream s;
+        s << value;
+        out += s.str();
+    }
+}
+
+// Аргументы строки: разделены пробелами, выражение с пробелами берётся в двойные кавычки
+static void split_arguments(std::string_view line, std::vector<std::string_view> &args) {
+    args.clear();
+    size_t i = 0;
+    while (i < line.length()) {
+        if (line[i] == ' ' || line[i] == '\t') {
+            ++i;
+            continue;
+        }
+        if (line[i] == '"') {
+            size_t close = line.find('"', i + 1);
+            if (close == std::string_view::npos)
+                throw std::runtime_error("Unterminated '\"'");
+            args.push_back(line.substr(i + 1, close - i - 1));
+            i = close + 1;
+            continue;
+        }
+        size_t start = i;
+        while (i < line.length() && line[i] != ' ' && line[i] != '\t') ++i;
+        args.push_back(line.substr(start, i - start));
+    }
+}
+
+std::string derivative_string(const Expression &expr, const std::string &x, Parentheses mode) {
+    std::unique_ptr<Expression> diff;
+    {
+        STATS(PhaseTimer timer(DIFFERENTIATE);)
+        diff = expr.differentiate(x);
+    }
+    simplify(diff);
+    STATS(PhaseTimer timer(TO_STRING);)
+    std::string result;
+    print(*diff, result, mode, true);
+    return result;
+}
+
+JobRunner::JobRunner(size_t max_cached) : max_cached(std::max<size_t>(max_cached, 1)) {}
+
+const JobRunner::CacheStats& JobRunner::stats() const {
+    return counters;
+}
+size_t JobRunner::size() const {
+    return entries.size();
+}
+size_t JobRunner::capacity() const {
+    return max_cached;
+}
+
+// Найденная запись переносится в начало списка
+JobRunner::Entry* JobRunner::find(std::string_view key) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        ++counters.misses;
+        return nullptr;
+    }
+    ++counters.hits;
+    entries.splice(entries.begin(), entries, it->second);
+    return &*it->second;
+}
+
+JobRunner::Entry& JobRunner::insert(Entry entry) {
+    if (entries.size() >= max_cached) {
+        index.erase(entries.back().key);
+        entries.pop_back();
+        ++counters.evictions;
+    }
+    entries.push_front(std::move(entry));
+    index.emplace(entries.front().key, entries.begin());
+    return entries.front();
+}
+
+JobRunner::Entry& JobRunner::lookup(std::string_view source) {
+    if (Entry *entry = find(source)) return *entry;
+    Entry entry;
+    entry.key = source;
+    entry.tree = Expression::create(source);
+    return insert(std::move(entry));
+}
+
+// Производная строится из дерева выражения до вставки: вытеснение при вставке может удалить и его
+JobRunner::Entry& JobRunner::lookup_derivative(std::string_view source, std::string_view x) {
+    thread_local std::string key;
+    key.assign(source).append(1, '\n').append(x);
+    if (Entry *entry = find(key)) return *entry;
+    Entry entry;
+    entry.key = key;
+    {
+        STATS(PhaseTimer timer(DIFFERENTIATE);)
+        entry.tree = lookup(source).tree->differentiate(std::string(x));
+    }
+    simplify(entry.tree);
+    STATS(PhaseTimer timer(TO_STRING);)
+    print(*entry.tree, entry.printed, Parentheses::FULL, true);
+    return insert(std::move(entry));
+}
+
+// Переменные, которых нет в строке, равны 0; лишние значения не используются
+T JobRunner::evaluate(Entry &entry, const std::vector<std::pair<std::string_view, T>> &values) {
+    thread_local std::vector<T> slots;
+    if (!entry.compiled) {
+        entry.program = compile(*entry.tree);
+        entry.compiled = true;
+    }
+    slots.assign(entry.program.variables.size(), T{});
+    for (auto &[name, value] : values) {
+        size_t slot = entry.program.slot(name);
+        if (slot < slots.size()) slots[slot] = value;
+    }
+    return entry.program.evaluate(slots.data());
+}
+
+void JobRunner::run(std::string_view line, std::string &out) {
+    thread_local std::vector<std::string_view> args;
+    thread_local std::vector<std::pair<std::string_view, T>> values;
+    try {
+        split_arguments(line, args);
+        if (args.empty()) return;
+        std::string_view by;
+        int order = 0;
+        bool value = false;
+        values.clear();
+        for (size_t i = 1; i < args.size(); ++i) {
+            if ((args[i] == "--by" || args[i] == "--order") && i + 1 < args.size()) {
+                if (args[i] == "--by") by = args[++i];
+                else order = std::stoi(std::string(args[++i]));
+                continue;
+            }
+            if (args[i] == "--value") {
+                value = true;
+                continue;
+            }
+            size_t pos = args[i].find('=');
+            std::string_view name = args[i].substr(0, pos == std::string_view::npos ? args[i].length() : pos);
+            std::string_view text = (pos == std::string_view::npos ? std::string_view() : args[i].substr(pos + 1));
+            if (!is_name(name))
+                throw std::runtime_error(std::string("Invalid variable name: ") + std::string(name));
+            if (!is_number(text))
+                throw std::runtime_error(std::string("Invalid variable value: ") + std::string(text));
+            values.push_back({name, to_number<T>(text)});
+        }
+        if (by.empty()) {
+            append_value(out, evaluate(lookup(args[0]), values));
+        } else if (order > 0) {
+            Entry &entry = lookup(args[0]);
+            std::map<std::string, T> point;
+            for (auto &[name, v] : values) point[std::string(name)] = v;
+            std::vector<T> result = derivatives(*entry.tree, std::string(by), order, point);
+            for (int k = 1; k <= order; ++k) {
+                if (k > 1) out += ' ';
+                append_value(out, result[k]);
+            }
+        } else {
+            Entry &entry = lookup_derivative(args[0], by);
+            if (value) append_value(out, evaluate(entry, values));
+            else out += entry.printed;
+        }
+    } catch (const std::exception &e) {
+        out += "error: ";
+        out += e.what();
+    }
+}
+
+int run_batch(const std::string &path, size_t threads) {
+    LineReader reader(path);
+    OutputBuffer output;
+    std::string_view line;
+    if (threads <= 1) {
+        JobRunner runner;
+        std::string result;
+        while (reader.next(line)) {
+            result.clear();
+            runner.run(line, result);
+            result += '\n';
+            output.write(result);
+        }
+        return 0;
+    }
+    // строки читаются блоками; блок выполняется параллельно, а выводится по порядку.
+    // У каждого потока свой JobRunner, так что кэши не делятся между потоками.
+    Executor executor(threads);
+    std::vector<JobRunner> runners(executor.size());
+    std::string text;
+    std::vector<size_t> ends;
+    std::vector<std::string> results(PARALLEL_LINES);
+    bool more = true;
+    while (more) {
+        text.clear();
+        ends.clear();
+        while (ends.size() < PARALLEL_LINES && (more = reader.next(line))) {
+            text.append(line);
+            ends.push_back(text.size());
+        }
+        executor.parallel_for(ends.size(), 64, [&](size_t worker, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                size_t start = (i == 0 ? 0 : ends[i - 1]);
+                results[i].clear();
+                runners[worker].run(std::string_view(text).substr(start, ends[i] - start), results[i]);
+                results[i] += '\n';
+            }
+        });
+        for (size_t i = 0; i < ends.size(); ++i)
+            output.write(results[i]);
+    }
+    return 0;
+}
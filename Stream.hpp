@@ -0,0 +1,95 @@
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+#include "Bytecode.hpp"
+#include "Printer.hpp"
+
+#include <list>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Построчное чтение задания: обычный файл отображается в память целиком (mmap),
+// stdin читается большими блоками. Строки выдаются как string_view без копирования
+// и живут до следующего вызова next().
+class LineReader {
+public:
+    // "" или "-" — стандартный ввод
+    explicit LineReader(const std::string &path);
+    ~LineReader();
+    LineReader(const LineReader &) = delete;
+    LineReader& operator=(const LineReader &) = delete;
+
+    bool next(std::string_view &);
+
+private:
+    int fd = -1;
+    const char *mapped = nullptr;
+    size_t mapped_size = 0, offset = 0;
+    std::vector<char> buffer;
+    size_t begin = 0, end = 0;
+    bool eof = false;
+};
+
+// Буферизованный вывод в stdout: сбрасывается блоками, а не построчно
+class OutputBuffer {
+public:
+    ~OutputBuffer();
+    void write(std::string_view);
+    void flush();
+
+private:
+    std::string data;
+};
+
+// Выполнение строк задания вида
+//     "x * y" x=10 y=12                      — значение выражения
+//     "x * sin(x)" --by x                    — символьная производная
+//     "x * sin(x)" --by x --value x=1        — значение упрощённой производной
+//     "exp(x)" --by x --order 3 x=1          — численные производные 1..k
+// Разобранные деревья, упрощённые производные и скомпилированные программы хранятся в LRU-кэше
+// по тексту выражения (производные — по тексту и переменной) не больше чем на max_cached записей,
+// так что память не растёт с длиной ввода.
+class JobRunner {
+public:
+    struct CacheStats {
+        size_t hits = 0, misses = 0, evictions = 0;
+    };
+
+    explicit JobRunner(size_t max_cached = 4096);
+    // дописывает в out результат задания (без перевода строки) или "error: ..." для ошибочной строки
+    void run(std::string_view, std::string &out);
+
+    const CacheStats& stats() const;
+    size_t size() const;
+    size_t capacity() const;
+
+private:
+    struct Entry {
+        std::string key;                    // текст выражения; у производной — текст, '\n' и переменная
+        std::unique_ptr<Expression> tree;   // у производной — упрощённая производная
+        std::string printed;                // напечатанная производная
+        Program program;
+        bool compiled = false;
+    };
+    // первый элемент — последний использованный; индекс указывает на ключи внутри списка
+    std::list<Entry> entries;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+    size_t max_cached;
+    CacheStats counters;
+
+    Entry* find(std::string_view key);
+    Entry& insert(Entry);
+    Entry& lookup(std::string_view source);
+    Entry& lookup_derivative(std::string_view source, std::string_view x);
+    T evaluate(Entry &, const std::vector<std::pair<std::string_view, T>> &);
+};
+
+// Символьная производная, упрощённая и напечатанная без внешних скобок
+std::string derivative_string(const Expression &, const std::string &x, Parentheses = Parentheses::FULL);
+
+// Режим --batch: задания из файла или stdin, результаты по строке на задание в stdout
+// в порядке заданий при любом числе потоков
+int run_batch(const std::string &path, size_t threads = 1);
+
+#endif
@@ -0,0 +1,150 @@
+#include "Taylor.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+Taylor::Taylor(T value) {
+    c[0] = value;
+}
+Taylor Taylor::variable(T x0, int order) {
+    if (order < 0 || order > TAYLOR_MAX_ORDER)
+        throw std::runtime_error("Taylor order must be in [0, " + std::to_string(TAYLOR_MAX_ORDER) + "]");
+    Taylor result(x0);
+    result.order = order;
+    if (order > 0) result.c[1] = 1;
+    return result;
+}
+T Taylor::derivative(int k) const {
+    T factorial = 1;
+    for (int i = 2; i <= k; ++i) factorial *= i;
+    return c[k] * factorial;
+}
+
+static Taylor like(const Taylor &a, const Taylor &b) {
+    Taylor result;
+    result.order = std::max(a.order, b.order);
+    return result;
+}
+
+Taylor operator+(const Taylor &a, const Taylor &b) {
+    Taylor r = like(a, b);
+    for (int k = 0; k <= r.order; ++k) r.c[k] = a.c[k] + b.c[k];
+    return r;
+}
+Taylor operator-(const Taylor &a, const Taylor &b) {
+    Taylor r = like(a, b);
+    for (int k = 0; k <= r.order; ++k) r.c[k] = a.c[k] - b.c[k];
+    return r;
+}
+Taylor operator*(const Taylor &a, const Taylor &b) {
+    Taylor r = like(a, b);
+    for (int k = 0; k <= r.order; ++k)
+        for (int j = 0; j <= k; ++j)
+            r.c[k] += a.c[j] * b.c[k - j];
+    return r;
+}
+Taylor operator/(const Taylor &a, const Taylor &b) {
+    Taylor r = like(a, b);
+    for (int k = 0; k <= r.order; ++k) {
+        T s = a.c[k];
+        for (int j = 1; j <= k; ++j)
+            s -= b.c[j] * r.c[k - j];
+        r.c[k] = s / b.c[0];
+    }
+    return r;
+}
+Taylor exp(const Taylor &a) {
+    Taylor r = like(a, a);
+    r.c[0] = exp(a.c[0]);
+    for (int k = 1; k <= r.order; ++k) {
+        T s = 0;
+        for (int j = 1; j <= k; ++j)
+            s += j * a.c[j] * r.c[k - j];
+        r.c[k] = s / k;
+    }
+    return r;
+}
+Taylor log(const Taylor &a) {
+    Taylor r = like(a, a);
+    r.c[0] = log(a.c[0]);
+    for (int k = 1; k <= r.order; ++k) {
+        T s = 0;
+        for (int j = 1; j < k; ++j)
+            s += j * r.c[j] * a.c[k - j];
+        r.c[k] = (a.c[k] - s / k) / a.c[0];
+    }
+    return r;
+}
+// sin и cos считаются совместно: рекуррентные формулы ссылаются друг на друга
+static void sin_cos(const Taylor &a, Taylor &s, Taylor &c) {
+    s = c = like(a, a);
+    s.c[0] = sin(a.c[0]);
+    c.c[0] = cos(a.c[0]);
+    for (int k = 1; k <= a.order; ++k) {
+        T ss = 0, cs = 0;
+        for (int j = 1; j <= k; ++j) {
+            ss += j * a.c[j] * c.c[k - j];
+            cs += j * a.c[j] * s.c[k - j];
+        }
+        s.c[k] = ss / k;
+        c.c[k] = -cs / k;
+    }
+}
+Taylor sin(const Taylor &a) {
+    Taylor s, c;
+    sin_cos(a, s, c);
+    return s;
+}
+Taylor cos(const Taylor &a) {
+    Taylor s, c;
+    sin_cos(a, s, c);
+    return c;
+}
+// Постоянный показатель: целый неотрицательный — умножениями (работает и при a(x0) = 0),
+// иначе рекуррентная формула степени; переменный показатель — через exp(b * ln(a)), как в дереве
+Taylor pow(const Taylor &a, const Taylor &b) {
+    bool constant_exponent = true;
+    for (int k = 1; k <= b.order; ++k)
+        if (b.c[k] != T(0)) constant_exponent = false;
+    if (!constant_exponent)
+        return exp(b * log(a));
+    T p = b.c[0];
+    // сравнение до int(p): вне диапазона int преобразование не определено
+    if (p == std::floor(p) && p >= 0 && p <= 64) {
+        Taylor result(1), base = a;
+        result.order = a.order;
+        for (int n = int(p); n > 0; n >>= 1) {
+            if (n & 1) result = result * base;
+            if (n > 1) base = base * base;
+        }
+        result.c[0] = pow(a.c[0], p);
+        return result;
+    }
+    Taylor r = like(a, a);
+    r.c[0] = pow(a.c[0], p);
+    for (int k = 1; k <= r.order; ++k) {
+        T s = 0;
+        for (int j = 1; j <= k; ++j)
+            s += (p * j - (k - j)) * a.c[j] * r.c[k - j];
+        r.c[k] = s / (k * a.c[0]);
+    }
+    return r;
+}
+
+std::vector<T> derivatives(const Expression &expr, const std::string &x, int order,
+                           const std::map<std::string, T> &point) {
+    if (order < 0 || order > TAYLOR_MAX_ORDER)
+        throw std::runtime_error("Taylor order must be in [0, " + std::to_string(TAYLOR_MAX_ORDER) + "]");
+    Program program = compile(expr);
+    std::vector<Taylor> slots(program.variables.size()), registers(program.size());
+    for (size_t i = 0; i < slots.size(); ++i) {
+        auto it = point.find(program.variables[i]);
+        T value = (it != point.end()) ? it->second : T{};
+        slots[i] = (program.variables[i] == x ? Taylor::variable(value, order) : Taylor(value));
+    }
+    Taylor series = program.run(slots.data(), registers.data());
+    std::vector<T> result(order + 1);
+    for (int k = 0; k <= order; ++k)
+        result[k] = series.derivative(k);
+    return result;
+}
@@ -0,0 +1,38 @@
+#ifndef TAYLOR_HPP
+#define TAYLOR_HPP
+
+#include "Bytecode.hpp"
+
+#include <vector>
+
+constexpr int TAYLOR_MAX_ORDER = 24;
+
+// Усечённый ряд Тейлора: c[k] = f^(k)(x0) / k!, k <= order.
+// Константа — ряд нулевого порядка, поэтому Taylor(T) годится для констант программы.
+// Прогон Program::run<Taylor> даёт все производные до order за один проход.
+class Taylor {
+public:
+    int order = 0;
+    T c[TAYLOR_MAX_ORDER + 1] = {};
+
+    Taylor(T = 0);
+    // x0 + h: ряд независимой переменной
+    static Taylor variable(T, int);
+    T derivative(int) const;
+};
+
+Taylor operator+(const Taylor &, const Taylor &);
+Taylor operator-(const Taylor &, const Taylor &);
+Taylor operator*(const Taylor &, const Taylor &);
+Taylor operator/(const Taylor &, const Taylor &);
+Taylor pow(const Taylor &, const Taylor &);
+Taylor sin(const Taylor &);
+Taylor cos(const Taylor &);
+Taylor log(const Taylor &);
+Taylor exp(const Taylor &);
+
+// Производные 0..order выражения по x в точке point
+std::vector<T> derivatives(const Expression &, const std::string &x, int order,
+                           const std::map<std::string, T> &point = {});
+
+#endif
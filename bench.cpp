@@ -0,0 +1,808 @@
+#include "Expression.hpp"
+#include "Bytecode.hpp"
+#include "Batch.hpp"
+#include "Dag.hpp"
+#include "Gradient.hpp"
+#include "Taylor.hpp"
+#include "Arena.hpp"
+#include "Executor.hpp"
+#include "Rewrite.hpp"
+#include "Native.hpp"
+#include "Static.hpp"
+#include "Incremental.hpp"
+#include "Serialize.hpp"
+#include "Jacobian.hpp"
+#include "Polynomial.hpp"
+#include "Server.hpp"
+#include "Interval.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sys/resource.h>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// Каждый замер печатается одной строкой JSON, например
+//     {"bench":"create","workload":"long_sum","size":1000,"nodes":...,"ns_per_op":...,"allocs_per_op":...}
+// Нагрузки генерируются детерминированно, так что запуски можно сравнивать между собой.
+// ./bench.exe [подстрока] — только бенчмарки, в имени которых есть подстрока.
+
+//-----------------//
+//---ALLOCATIONS---//
+//-----------------//
+// Считаются все выделения памяти процесса: узлы, строки, контейнеры. Заменены все формы new и delete —
+// обычные, массивы, nothrow, с размером и с выравниванием, — чтобы любая пара new/delete шла через одну
+// пару allocate/release. release не встраивается: иначе GCC видит free() на указателе из operator new
+// и предупреждает о несовпадении (-Wmismatched-new-delete)
+static std::atomic<size_t> allocations = 0;
+
+static void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+    ++allocations;
+    void *p = nullptr;
+    if (alignment <= alignof(std::max_align_t)) p = std::malloc(size ? size : 1);
+    else p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    return p;
+}
+[[gnu::noinline]] static void release(void *p) noexcept {
+    std::free(p);
+}
+
+void* operator new(size_t size) {
+    if (void *p = allocate(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) {
+    if (void *p = allocate(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+    if (void *p = allocate(size, size_t(alignment))) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+    if (void *p = allocate(size, size_t(alignment))) return p;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+void* operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+void operator delete(void *p) noexcept {
+    release(p);
+}
+void operator delete[](void *p) noexcept {
+    release(p);
+}
+void operator delete(void *p, size_t) noexcept {
+    release(p);
+}
+void operator delete[](void *p, size_t) noexcept {
+    release(p);
+}
+void operator delete(void *p, std::align_val_t) noexcept {
+    release(p);
+}
+void operator delete[](void *p, std::align_val_t) noexcept {
+    release(p);
+}
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+    release(p);
+}
+void operator delete[](void *p, size_t, std::align_val_t) noexcept {
+    release(p);
+}
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+    release(p);
+}
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+    release(p);
+}
+
+
+//-------------//
+//---HARNESS---//
+//-------------//
+// результаты складываются сюда, чтобы компилятор не выбросил замеряемый код
+T sink = 0;
+
+struct Sample {
+    double ns_per_op;
+    double allocs_per_op;
+};
+
+// медиана времени по repeats запускам и среднее число выделений памяти на запуск
+template <typename F>
+Sample measure(F f, int repeats = 5) {
+    std::vector<double> times;
+    size_t before = allocations;
+    for (int i = 0; i < repeats; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto finish = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::nano>(finish - start).count());
+    }
+    size_t allocated = allocations - before;
+    std::sort(times.begin(), times.end());
+    return {times[times.size() / 2], double(allocated) / repeats};
+}
+
+class Record {
+public:
+    explicit Record(const std::string &bench) {
+        body << "{\"bench\":\"" << bench << "\"";
+    }
+    Record& add(const std::string &key, const std::string &value) {
+        body << ",\"" << key << "\":\"" << value << "\"";
+        return *this;
+    }
+    Record& add(const std::string &key, double value) {
+        body << ",\"" << key << "\":" << value;
+        return *this;
+    }
+    Record& add(const Sample &sample, const std::string &prefix = "") {
+        return add(prefix + "ns_per_op", sample.ns_per_op).add(prefix + "allocs_per_op", sample.allocs_per_op);
+    }
+    void print() {
+        std::cout << body.str() << "}" << std::endl;
+    }
+
+private:
+    std::ostringstream body;
+};
+
+
+//---------------//
+//---WORKLOADS---//
+//---------------//
+// Длинная сумма из n слагаемых вида "sin(x * 3) + (y - 2.5) / 7 - exp(ln(x) * 2) + x ^ 2"
+std::string long_sum(size_t n) {
+    const std::string terms[4] = {"sin(x * 3)", "(y - 2.5) / 7", "exp(ln(x) * 2)", "x ^ 2"};
+    std::string source;
+    for (size_t i = 0; i < n; ++i) {
+        if (i > 0) source += (i % 3 == 0 ? " - " : " + ");
+        source += terms[i % 4];
+    }
+    return source;
+}
+// Вложенность глубины d: чередование sin(...) и (... * y + 1)
+std::string deep_nesting(size_t d) {
+    std::string source = "x";
+    for (size_t i = 0; i < d; ++i)
+        source = (i % 2 ? "sin(" + source + ")" : "(" + source + " * y + 1)");
+    return source;
+}
+// k-я производная sin(x) * x * exp(x) в текстовом виде
+std::string repeated_derivative(size_t k) {
+    std::unique_ptr<Expression> expr = Expression::create("sin(x) * x * exp(x)");
+    for (size_t i = 0; i < k; ++i) expr = expr->differentiate("x");
+    return expr->to_string();
+}
+
+// -(-(... + x) + x) глубины 2 * d: вложенные скобки и унарные минусы
+std::string deep_negation(size_t d) {
+    std::string source;
+    source.reserve(7 * d + 1);
+    for (size_t i = 0; i < d; ++i) source += "-(";
+    source += "x";
+    for (size_t i = 0; i < d; ++i) source += " + x)";
+    return source;
+}
+
+struct Workload {
+    std::string name;
+    size_t size;
+    std::string source;
+};
+
+std::vector<Workload> workloads() {
+    std::vector<Workload> result;
+    for (size_t n = 1000; n <= 16000; n *= 2) result.push_back({"long_sum", n, long_sum(n)});
+    for (size_t d = 64; d <= 1024; d *= 2) result.push_back({"deep_nesting", d, deep_nesting(d)});
+    for (size_t k = 1; k <= 5; ++k) result.push_back({"repeated_derivative", k, repeated_derivative(k)});
+    return result;
+}
+
+
+//----------//
+//---CORE---//
+//----------//
+// Expression::create, clone, evaluate, differentiate, simplify и to_string на каждой нагрузке
+void bench_core() {
+    const std::map<std::string, T> point = {{"x", 1.3}, {"y", 0.7}};
+    for (const Workload &w : workloads()) {
+        std::unique_ptr<Expression> expr = Expression::create(w.source);
+        std::unique_ptr<Expression> der = expr->differentiate("x");
+        std::unique_ptr<Expression> simple = der->clone();
+        simplify(simple);
+        size_t nodes = count_nodes(*expr);
+        auto record = [&](const std::string &stage) {
+            Record result(stage);
+            result.add("workload", w.name).add("size", w.size).add("nodes", nodes);
+            return result;
+        };
+
+        record("create").add(measure([&]() { Expression::create(w.source); })).print();
+        record("clone").add(measure([&]() { expr->clone(); })).print();
+        record("evaluate").add(measure([&]() { sink += expr->evaluate(point); })).print();
+        record("differentiate").add("result_nodes", count_nodes(*der))
+            .add(measure([&]() { expr->differentiate("x"); })).print();
+        // simplify меняет дерево, поэтому копии для каждого запуска готовятся заранее, вне замера
+        std::vector<std::unique_ptr<Expression>> copies;
+        for (int i = 0; i < 3; ++i) copies.push_back(der->clone());
+        size_t next = 0;
+        Sample simplified = measure([&]() { simplify(copies[next++]); }, copies.size());
+        record("simplify").add("derivative_nodes", count_nodes(*der)).add("result_nodes", count_nodes(*simple))
+            .add(simplified).print();
+        record("to_string").add(measure([&]() { expr->to_string(); })).print();
+    }
+}
+
+
+//--------------//
+//---FEATURES---//
+//--------------//
+// Дерево с std::map против скомпилированной программы со слотами
+void bench_compiled() {
+    for (size_t n = 10; n <= 1000; n *= 10) {
+        std::unique_ptr<Expression> expr = Expression::create(long_sum(n));
+        Program program = compile(*expr);
+        T slots[2];
+        size_t x = program.slot("x"), y = program.slot("y");
+        Sample tree = measure([&]() { sink += expr->evaluate({{"x", 1.3}, {"y", 2}}); }, 101);
+        Sample compiled = measure([&]() {
+            slots[x] = 1.3, slots[y] = 2;
+            sink += program.evaluate(slots);
+        }, 101);
+        Record("compiled").add("workload", "long_sum").add("size", n).add("nodes", count_nodes(*expr))
+            .add(tree, "tree_").add(compiled, "compiled_").print();
+    }
+}
+
+// Построчное вычисление программы против блочного (long double и векторный double)
+void bench_batch() {
+    std::unique_ptr<Expression> expr = Expression::create("sin(x) * exp(y / 3) + ln(x + 2) - cos(y) * x / (y + 1)");
+    Program program = compile(*expr);
+    for (size_t rows = 1000; rows <= 1000000; rows *= 10) {
+        std::vector<long double> x(rows), y(rows), out(rows);
+        std::vector<double> x_d(rows), y_d(rows), out_d(rows);
+        for (size_t i = 0; i < rows; ++i) {
+            x_d[i] = x[i] = 0.5 + i * 1e-6L;
+            y_d[i] = y[i] = 3 - i * 1e-6L;
+        }
+        std::vector<const long double *> columns(2);
+        std::vector<const double *> columns_d(2);
+        columns[program.slot("x")] = x.data(), columns[program.slot("y")] = y.data();
+        columns_d[program.slot("x")] = x_d.data(), columns_d[program.slot("y")] = y_d.data();
+        Sample scalar = measure([&]() {
+            T slots[2];
+            for (size_t i = 0; i < rows; ++i) {
+                slots[program.slot("x")] = x[i];
+                slots[program.slot("y")] = y[i];
+                sink += program.evaluate(slots);
+            }
+        }, 3);
+        Sample batch = measure([&]() { evaluate_batch(program, columns.data(), rows, out.data()); }, 3);
+        Sample batch_d = measure([&]() { evaluate_batch(program, columns_d.data(), rows, out_d.data()); }, 3);
+        sink += out[rows - 1] + out_d[rows - 1];
+        Record("batch").add("rows", rows).add("scalar_ns_per_row", scalar.ns_per_op / rows)
+            .add("long_double_ns_per_row", batch.ns_per_op / rows).add("double_ns_per_row", batch_d.ns_per_op / rows)
+            .print();
+    }
+}
+
+// Размер производных в дереве и в хранилище с хеш-консингом (до и после упрощения)
+void bench_dag() {
+    for (int depth = 2; depth <= 64; depth *= 2) {
+        std::string source = "x";
+        for (int i = 0; i < depth; ++i) source = "sin(x * " + source + ")";
+        std::unique_ptr<Expression> expr = Expression::create(source);
+        NodeStore store;
+        NodeStore::Id d = store.differentiate(store.insert(*expr), "x");
+        Record("dag").add("workload", "nested_sin").add("size", depth)
+            .add("tree_nodes", count_nodes(*expr->differentiate("x"))).add("dag_nodes", store.count(d))
+            .add("simplified_dag_nodes", store.count(store.simplify(d))).print();
+    }
+    std::unique_ptr<Expression> tree = Expression::create("sin(x) * x * exp(x)");
+    NodeStore store;
+    NodeStore::Id id = store.insert(*tree), simple = id;
+    for (int order = 1; order <= 6; ++order) {
+        tree = tree->differentiate("x");
+        id = store.differentiate(id, "x");
+        simple = store.simplify(store.differentiate(simple, "x"));
+        Record("dag").add("workload", "repeated_derivative").add("size", order).add("tree_nodes", count_nodes(*tree))
+            .add("dag_nodes", store.count(id)).add("simplified_dag_nodes", store.count(simple)).print();
+    }
+}
+
+// Градиент по n переменным: n символьных производных против одного обратного прохода
+void bench_gradient() {
+    for (int n = 25; n <= 200; n *= 2) {
+        std::string source;
+        std::vector<std::string> vars;
+        std::map<std::string, T> point;
+        for (int i = 0; i < n; ++i) {
+            std::string xi = "x" + std::to_string(i), xj = "x" + std::to_string((i + 1) % n);
+            source += (i ? " + " : "") + std::string("sin(") + xi + " * " + xj + ") * exp(" + xi + " / 10)";
+            vars.push_back(xi);
+            point[xi] = 0.1 + i * 0.01L;
+        }
+        std::unique_ptr<Expression> expr = Expression::create(source);
+        Sample symbolic = measure([&]() {
+            for (const std::string &x : vars) {
+                std::unique_ptr<Expression> d = expr->differentiate(x);
+                simplify(d);
+                sink += d->evaluate(point);
+            }
+        }, 1);
+        Sample reverse = measure([&]() { sink += gradient(*expr, vars, point).second[0]; }, 5);
+        Record("gradient").add("variables", n).add(symbolic, "symbolic_").add(reverse, "reverse_").print();
+    }
+}
+
+// k-я производная: k символьных дифференцирований против одного прохода рядами Тейлора
+void bench_taylor() {
+    std::unique_ptr<Expression> expr = Expression::create("exp(sin(x)) * ln(x)");
+    for (int order = 1; order <= 6; ++order) {
+        size_t nodes = 0;
+        Sample symbolic = measure([&]() {
+            std::unique_ptr<Expression> d = expr->clone();
+            for (int k = 0; k < order; ++k) d = d->differentiate("x");
+            nodes = count_nodes(*d);
+            sink += d->evaluate({{"x", 1.2}});
+        }, 1);
+        Sample taylor = measure([&]() { sink += derivatives(*expr, "x", order, {{"x", 1.2}})[order]; }, 11);
+        Record("taylor").add("order", order).add("symbolic_nodes", nodes).add(symbolic, "symbolic_")
+            .add(taylor, "taylor_").print();
+    }
+}
+
+// Повторные производные: один проход тождеств с 0 и 1 против каноникализации до неподвижной точки
+void bench_rewrite() {
+    const std::map<std::string, T> point = {{"x", 0.7}};
+    for (const char *source : {"sin(x) * x * exp(x)", "exp(sin(x)) * ln(x) / x ^ 2"}) {
+        std::unique_ptr<Expression> der = Expression::create(source);
+        for (int order = 1; order <= 6; ++order) {
+            der = der->differentiate("x");
+            std::unique_ptr<Expression> local = der->clone();
+            if (auto [e, type] = local->simplify(); e) local = std::move(e);
+            std::unique_ptr<Expression> canonical = local->clone();
+            Sample rewrite = measure([&]() { canonical = canonicalize(*local); }, 3);
+            if (!canonical) canonical = local->clone();
+            Record("rewrite").add("workload", source).add("order", order).add("nodes", count_nodes(*der))
+                .add("local_nodes", count_nodes(*local)).add("canonical_nodes", count_nodes(*canonical))
+                .add(rewrite, "rewrite_")
+                .add("local_evaluate_ns", measure([&]() { sink += local->evaluate(point); }, 11).ns_per_op)
+                .add("canonical_evaluate_ns", measure([&]() { sink += canonical->evaluate(point); }, 11).ns_per_op)
+                .print();
+        }
+    }
+}
+
+// Формула, разобранная при компиляции, против дерева и программы: значение и производная
+void bench_static() {
+    using F = compiletime::Formula<"sin(x) * exp(y / 3) + ln(x + 2) - cos(y) * x / (y + 1)">;
+    using D = F::derivative<"x">;
+    std::unique_ptr<Expression> expr = F::expression(), der = expr->differentiate("x");
+    Program program = compile(*expr), derivative = compile(*der);
+    const std::map<std::string, T> point = {{"x", 1.3}, {"y", 0.4}};
+    T slots[2] = {1.3, 0.4};
+    auto record = [&](const std::string &what, const Expression &tree, const Program &compiled, auto formula) {
+        Record("static").add("function", what).add("nodes", count_nodes(tree))
+            .add("tree_ns_per_op", measure([&]() { sink += tree.evaluate(point); }, 1001).ns_per_op)
+            .add("compiled_ns_per_op", measure([&]() { sink += compiled.evaluate(slots); }, 1001).ns_per_op)
+            .add("static_ns_per_op", measure([&]() { sink += formula(slots); }, 1001).ns_per_op).print();
+    };
+    record("value", *expr, program, [](volatile T *s) { return F::evaluate(s[0], s[1]); });
+    record("derivative", *der, derivative, [](volatile T *s) { return D::evaluate(s[0], s[1]); });
+}
+
+// Шаг моделирования меняет одну переменную из n: полный прогон программы против пересчёта грязного подграфа
+void bench_incremental() {
+    for (int n = 16; n <= 256; n *= 4) {
+        std::string source;
+        for (int i = 0; i < n; ++i) {
+            std::string xi = "x" + std::to_string(i), xj = "x" + std::to_string((i + 1) % n);
+            source += (i ? " + " : "") + std::string("sin(") + xi + " * " + xj + ") * exp(" + xi + " / 10)";
+        }
+        std::unique_ptr<Expression> expr = Expression::create(source);
+        IncrementalContext context(*expr);
+        const Program &program = context.program();
+        std::vector<T> slots(n);
+        for (int i = 0; i < n; ++i) context.set(i, slots[i] = 0.1 + i * 0.01L);
+        context.value();
+        context.reset_counters();
+        int step = 0;
+        Sample full = measure([&]() {
+            slots[step++ % n] += 1e-3L;
+            sink += program.evaluate(slots.data());
+        }, 101);
+        step = 0;
+        Sample incremental = measure([&]() {
+            size_t slot = step++ % n;
+            context.set(slot, slots[slot] += 1e-3L);
+            sink += context.value();
+        }, 101);
+        Record("incremental").add("variables", n).add("instructions", program.size())
+            .add("recomputed_per_step", double(context.counters().recomputed) / context.counters().evaluations)
+            .add(full, "full_").add(incremental, "incremental_").print();
+    }
+}
+
+// Одно дерево в каждом инстанцированном числовом типе: разбор, производная, вычисление
+template <typename N>
+void bench_scalar_type(const char *type, const Workload &w) {
+    std::unique_ptr<BasicExpression<N>> expr = BasicExpression<N>::create(w.source);
+    std::unique_ptr<BasicExpression<N>> der = expr->differentiate("x");
+    const std::map<std::string, N> point = {{"x", N(1.3)}, {"y", N(0.7)}};
+    Sample create = measure([&]() { BasicExpression<N>::create(w.source); }, 5);
+    Sample differentiate = measure([&]() { expr->differentiate("x"); }, 5);
+    Sample evaluate = measure([&]() { sink += std::abs(der->evaluate(point)); }, 11);
+    Record("scalar").add("type", type).add("workload", w.name).add("size", w.size).add("nodes", count_nodes(*der))
+        .add(create, "create_").add(differentiate, "differentiate_").add(evaluate, "evaluate_").print();
+}
+void bench_scalar() {
+    for (const Workload &w : {Workload{"long_sum", 4000, long_sum(4000)},
+                              Workload{"repeated_derivative", 4, repeated_derivative(4)}}) {
+        bench_scalar_type<float>("float", w);
+        bench_scalar_type<double>("double", w);
+        bench_scalar_type<long double>("long double", w);
+        bench_scalar_type<std::complex<double>>("complex<double>", w);
+    }
+}
+
+// Старт процесса: разбор текста и компиляция против загрузки готового файла
+void bench_serialize() {
+    std::string path = (std::filesystem::temp_directory_path() / "differentiator-bench.expr").string();
+    for (size_t n = 1000; n <= 16000; n *= 4) {
+        std::string source = long_sum(n);
+        save(path, *Expression::create(source));
+        Sample parse = measure([&]() { sink += compile(*Expression::create(source)).evaluate({{"x", 1.3}}); }, 11);
+        Sample load = measure([&]() { sink += ExpressionFile(path).evaluate({{"x", 1.3}})[0]; }, 11);
+        Record("serialize").add("workload", "long_sum").add("size", n)
+            .add("text_bytes", source.size()).add("file_bytes", std::filesystem::file_size(path))
+            .add(parse, "parse_").add(load, "load_").print();
+    }
+    std::remove(path.c_str());
+}
+
+// Семейство повторных производных с упрощением: узлы в куче против узлов в арене
+void bench_arena() {
+    std::unique_ptr<Expression> expr = Expression::create("sin(x) * x * exp(x) / (x + 1)");
+    auto family = [&](int order) {
+        std::vector<std::unique_ptr<Expression>> result;
+        result.push_back(expr->clone());
+        for (int k = 0; k < order; ++k) {
+            result.push_back(result.back()->differentiate("x"));
+            simplify(result.back());
+        }
+        return result;
+    };
+    for (int order = 2; order <= 6; ++order) {
+        Sample heap = measure([&]() { family(order); }, 3);
+        size_t nodes = 0, bytes = 0;
+        Sample arena = measure([&]() {
+            ExpressionArena arena;
+            {
+                ExpressionArena::Scope scope(arena);
+                for (std::unique_ptr<Expression> &d : family(order)) arena.adopt(std::move(d));
+            }
+            nodes = arena.nodes(), bytes = arena.bytes();
+        }, 3);
+        Record("arena").add("order", order).add("nodes", nodes).add("arena_bytes", bytes).add(heap, "heap_")
+            .add(arena, "arena_").print();
+    }
+}
+
+// Машинный код против программы: сборка без кэша и с кэшем, затем время на строку
+void bench_native() {
+    std::unique_ptr<Expression> expr = Expression::create("sin(x) * exp(y / 3) + ln(x + 2) - cos(y) * x / (y + 1)");
+    Program program = compile(*expr);
+    std::string cache = (std::filesystem::temp_directory_path() / "differentiator-bench").string();
+    std::filesystem::remove_all(cache);
+    std::unique_ptr<NativeFunction> native;
+    Sample cold = measure([&]() { native = std::make_unique<NativeFunction>(*expr, std::vector<std::string>(), cache); }, 1);
+    Sample warm = measure([&]() { native = std::make_unique<NativeFunction>(*expr, std::vector<std::string>(), cache); }, 5);
+    size_t rows = 1000000;
+    std::vector<long double> x(rows), y(rows), out(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        x[i] = 0.5 + i * 1e-6L;
+        y[i] = 3 - i * 1e-6L;
+    }
+    std::vector<const long double *> columns(2), native_columns(2);
+    columns[program.slot("x")] = x.data(), columns[program.slot("y")] = y.data();
+    for (size_t j = 0; j < 2; ++j) native_columns[j] = (native->variables()[j] == "x" ? x.data() : y.data());
+    Sample batch = measure([&]() { evaluate_batch(program, columns.data(), rows, out.data()); }, 3);
+    Sample kernel = measure([&]() { native->evaluate_batch(native_columns.data(), rows, out.data()); }, 3);
+    sink += out[rows / 2];
+    Record("native").add("native", native->is_native()).add("rows", rows).add(cold, "build_cold_")
+        .add(warm, "build_cached_").add("batch_ns_per_row", batch.ns_per_op / rows)
+        .add("native_ns_per_row", kernel.ns_per_op / rows).print();
+}
+
+// Масштабирование по потокам: 4 миллиона строк, double и long double
+void bench_parallel() {
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    std::unique_ptr<Expression> expr = Expression::create("sin(x) * exp(y / 3) + ln(x + 2) - cos(y) * x / (y + 1)");
+    Program program = compile(*expr);
+    size_t rows = 4000000;
+    std::vector<long double> x(rows), y(rows), out(rows);
+    std::vector<double> x_d(rows), y_d(rows), out_d(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        x_d[i] = x[i] = 0.5 + i * 1e-7L;
+        y_d[i] = y[i] = 3 - i * 1e-7L;
+    }
+    std::vector<const long double *> columns(2);
+    std::vector<const double *> columns_d(2);
+    columns[program.slot("x")] = x.data(), columns[program.slot("y")] = y.data();
+    columns_d[program.slot("x")] = x_d.data(), columns_d[program.slot("y")] = y_d.data();
+    for (size_t threads = 1; threads <= std::max<size_t>(cores, 4); threads *= 2) {
+        Executor executor(threads);
+        Sample t = measure([&]() { evaluate_parallel(program, columns.data(), rows, out.data(), executor); }, 1);
+        Sample t_d = measure([&]() { evaluate_parallel(program, columns_d.data(), rows, out_d.data(), executor); }, 1);
+        sink += out[rows / 2] + out_d[rows / 2];
+        Record("parallel").add("cores", cores).add("threads", threads).add("rows", rows)
+            .add("long_double_ns_per_row", t.ns_per_op / rows).add("double_ns_per_row", t_d.ns_per_op / rows).print();
+    }
+}
+
+// Пиковый размер резидентной памяти процесса (растёт только вверх)
+static size_t peak_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Каждый обход на дереве из 10^6 узлов и на дереве глубины 10^5: время, выделения и пиковая память
+void bench_stress() {
+    const std::map<std::string, T> point = {{"x", 1.3}, {"y", 0.7}};
+    for (const Workload &w : {Workload{"long_sum", 190000, long_sum(190000)},
+                              Workload{"deep_negation", 50000, deep_negation(50000)}}) {
+        std::unique_ptr<Expression> expr, der, copy;
+        Sample create = measure([&]() { expr = Expression::create(w.source); }, 1);
+        Sample evaluate = measure([&]() { sink += expr->evaluate(point); }, 1);
+        Sample differentiate = measure([&]() { der = expr->differentiate("x"); }, 1);
+        Sample clone = measure([&]() { copy = der->clone(); }, 1);
+        Sample simplified = measure([&]() { simplify(der); }, 1);
+        Sample print = measure([&]() { sink += expr->to_string().size(); }, 1);
+        Sample destroy = measure([&]() { copy.reset(); }, 1);
+        Record("stress").add("workload", w.name).add("size", w.size).add("nodes", count_nodes(*expr))
+            .add("depth", tree_depth(*expr)).add(create, "create_").add(evaluate, "evaluate_")
+            .add(differentiate, "differentiate_").add(clone, "clone_").add(simplified, "simplify_")
+            .add(print, "to_string_").add(destroy, "destroy_").add("peak_rss_kb", peak_rss_kb()).print();
+    }
+}
+
+// Якобиан и гессианы n выражений по n переменным: дерево по каждой паре против общего хранилища по потокам
+void bench_jacobian() {
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    for (int n = 8; n <= 32; n *= 2) {
+        std::vector<std::unique_ptr<Expression>> owned;
+        std::vector<const Expression *> functions;
+        std::vector<std::string> vars;
+        for (int i = 0; i < n; ++i) vars.push_back("x" + std::to_string(i));
+        for (int i = 0; i < n; ++i) {
+            const std::string &a = vars[i], &b = vars[(i + 1) % n], &c = vars[(i + 2) % n];
+            owned.push_back(Expression::create("sin(" + a + " * " + b + ") * exp(" + c + " / 10) + ln(" + a +
+                                               " ^ 2 + 1) * " + b + " - " + c + " / (" + a + " + 2)"));
+            functions.push_back(owned.back().get());
+        }
+        Sample tree = measure([&]() {
+            for (const Expression *f : functions)
+                for (size_t j = 0; j < vars.size(); ++j) {
+                    std::unique_ptr<Expression> d = f->differentiate(vars[j]);
+                    simplify(d);
+                    for (size_t k = j; k < vars.size(); ++k) {
+                        std::unique_ptr<Expression> h = d->differentiate(vars[k]);
+                        simplify(h);
+                        sink += count_nodes(*h);
+                    }
+                }
+        }, 1);
+        Record record("jacobian");
+        record.add("size", n).add(tree, "tree_");
+        for (size_t threads = 1; threads <= std::max<size_t>(cores, 4); threads *= 2) {
+            Executor executor(threads);
+            size_t nodes = 0;
+            Sample t = measure([&]() { nodes = jacobian(functions, vars, executor, true).store.size(); }, 3);
+            record.add("threads_" + std::to_string(threads) + "_ns_per_op", t.ns_per_op);
+            if (threads == 1) record.add("store_nodes", nodes);
+        }
+        record.print();
+    }
+}
+
+// Многочлен степени n, записанный членами a * x ^ k: дерево и программа против формы Горнера,
+// производная дерева против сдвига коэффициентов (построение и вычисление отдельно)
+void bench_horner() {
+    const std::map<std::string, T> point = {{"x", 0.9}};
+    for (size_t n = 4; n <= 64; n *= 4) {
+        std::string source = "1";
+        for (size_t k = 1; k <= n; ++k)
+            source += (k % 2 ? " - " : " + ") + std::to_string(k) + " * x ^ " + std::to_string(k);
+        std::unique_ptr<Expression> expr = Expression::create(source), fast = horner(*expr);
+        Program program = compile(*expr), fast_program = compile(*fast);
+        T slot = 0.9;
+        Sample tree = measure([&]() { sink += expr->evaluate(point); }, 101);
+        Sample tree_horner = measure([&]() { sink += fast->evaluate(point); }, 101);
+        Sample compiled = measure([&]() { sink += program.evaluate(&slot); }, 101);
+        Sample compiled_horner = measure([&]() { sink += fast_program.evaluate(&slot); }, 101);
+        Sample build = measure([&]() { sink += count_nodes(*expr->differentiate("x")); }, 101);
+        Sample build_horner = measure([&]() { sink += count_nodes(*horner_derivative(*expr, "x")); }, 101);
+        std::unique_ptr<Expression> der = expr->differentiate("x"), der_horner = horner_derivative(*expr, "x");
+        Sample derivative = measure([&]() { sink += der->evaluate(point); }, 101);
+        Sample derivative_horner = measure([&]() { sink += der_horner->evaluate(point); }, 101);
+        Record("horner").add("degree", n).add("nodes", count_nodes(*expr)).add("horner_nodes", count_nodes(*fast))
+            .add(tree, "tree_").add(tree_horner, "tree_horner_").add(compiled, "compiled_")
+            .add(compiled_horner, "compiled_horner_").add(build, "build_").add(build_horner, "build_horner_")
+            .add(derivative, "derivative_").add(derivative_horner, "derivative_horner_").print();
+    }
+}
+
+// Модель с 3n параметрами и двумя свободными переменными: полная карта значений против выражения,
+// специализированного на параметрах (и то же после компиляции)
+void bench_specialize() {
+    for (size_t n = 4; n <= 64; n *= 4) {
+        std::string source = "0";
+        std::map<std::string, T> bindings;
+        for (size_t i = 0; i < n; ++i) {
+            std::string p = "p" + std::to_string(i), q = "q" + std::to_string(i), r = "r" + std::to_string(i);
+            source += " + " + p + " * sin(" + q + " * x + " + r + " * y) + exp(" + p + " / " + q + ") * ln(" + r +
+                      " ^ 2 + 1) * y";
+            bindings[p] = 0.5 + i, bindings[q] = 1.0 / (i + 2), bindings[r] = 0.1 * i;
+        }
+        std::map<std::string, T> full = bindings, point = {{"x", 1.3}, {"y", 0.7}};
+        full.insert(point.begin(), point.end());
+        std::unique_ptr<Expression> expr = Expression::create(source), fixed = specialize(*expr, bindings);
+        Program program = compile(*expr), fixed_program = compile(*fixed);
+        std::vector<T> slots(program.variables.size()), fixed_slots(fixed_program.variables.size());
+        for (auto &[name, value] : full) slots[program.slot(name)] = value;
+        fixed_slots[fixed_program.slot("x")] = 1.3, fixed_slots[fixed_program.slot("y")] = 0.7;
+        Sample build = measure([&]() { sink += count_nodes(*specialize(*expr, bindings)); }, 11);
+        Sample tree = measure([&]() { sink += expr->evaluate(full); }, 101);
+        Sample tree_fixed = measure([&]() { sink += fixed->evaluate(point); }, 101);
+        Sample compiled = measure([&]() { sink += program.evaluate(slots.data()); }, 101);
+        Sample compiled_fixed = measure([&]() { sink += fixed_program.evaluate(fixed_slots.data()); }, 101);
+        Record("specialize").add("parameters", 3 * n).add("nodes", count_nodes(*expr)).add("fixed_nodes", count_nodes(*fixed))
+            .add(build, "specialize_").add(tree, "tree_").add(tree_fixed, "tree_fixed_").add(compiled, "compiled_")
+            .add(compiled_fixed, "compiled_fixed_").print();
+    }
+}
+
+// Повторяющиеся формулы через Server: запрос с прогретым кэшем против разбора, производной
+// и упрощения заново на каждый вызов (свежий JobRunner)
+void bench_server() {
+    std::vector<std::string> lines;
+    for (size_t i = 0; i < 16; ++i) {
+        std::string source = "\"" + long_sum(8 + i) + "\"";
+        lines.push_back(source + " x=1.3 y=0.7");
+        lines.push_back(source + " --by x");
+        lines.push_back(source + " --by y --value x=1.3 y=0.7");
+    }
+    Server server;
+    std::string out;
+    size_t next = 0;
+    Sample cold = measure([&]() {
+        JobRunner runner(1);
+        out.clear();
+        runner.run(lines[next++ % lines.size()], out);
+        sink += out.size();
+    }, 11);
+    for (const std::string &line : lines) server.handle(line, out);
+    Sample warm = measure([&]() {
+        out.clear();
+        server.handle(lines[next++ % lines.size()], out);
+        sink += out.size();
+    }, 1001);
+    Record("server").add("formulas", 16).add("lines", lines.size()).add(cold, "uncached_").add(warm, "cached_").print();
+}
+
+// Ядра double на 4096 элементах: скалярная libm, точные и быстрые векторные ядра; x ^ n — pow против
+// умножений; затем программа с тригонометрией и степенями в обоих режимах
+void bench_fastmath() {
+    const size_t n = 4096;
+    std::vector<double> x(n), out(n);
+    for (size_t i = 0; i < n; ++i) x[i] = 0.25 + i * 1e-3;
+    for (char op : {'s', 'c', 'e', 'l'}) {
+        Sample libm = measure([&]() {
+            for (size_t i = 0; i < n; ++i) out[i] = apply_unary(op, x[i]);
+            sink += out[n - 1];
+        }, 101);
+        Sample accurate = measure([&]() { kernel_unary(op, x.data(), out.data(), n); sink += out[n - 1]; }, 101);
+        Sample fast = measure([&]() { kernel_unary(op, x.data(), out.data(), n, MathMode::FAST); sink += out[n - 1]; }, 101);
+        Record("fastmath").add("op", std::string(1, op)).add("libm_ns_per_element", libm.ns_per_op / n)
+            .add("accurate_ns_per_element", accurate.ns_per_op / n).add("fast_ns_per_element", fast.ns_per_op / n).print();
+    }
+    for (int p : {2, 3, -2, 7}) {
+        std::vector<double> exponent(n, p);
+        Sample pow = measure([&]() { kernel_binary('^', x.data(), exponent.data(), out.data(), n); sink += out[n - 1]; }, 101);
+        Sample power = measure([&]() { kernel_power(x.data(), p, out.data(), n); sink += out[n - 1]; }, 101);
+        Record("fastmath").add("op", "^" + std::to_string(p)).add("libm_ns_per_element", pow.ns_per_op / n)
+            .add("multiply_ns_per_element", power.ns_per_op / n).print();
+    }
+    Program program = compile(*Expression::create("sin(x) * cos(y) + exp(-x ^ 2 / 2) * y ^ 3 - ln(x ^ 2 + y ^ 2)"));
+    std::vector<double> y(n);
+    for (size_t i = 0; i < n; ++i) y[i] = 2 - i * 1e-4;
+    std::vector<const double *> columns(2);
+    columns[program.slot("x")] = x.data(), columns[program.slot("y")] = y.data();
+    Sample scalar = measure([&]() {
+        std::vector<T> slots(2);
+        for (size_t i = 0; i < n; ++i) {
+            slots[program.slot("x")] = x[i], slots[program.slot("y")] = y[i];
+            sink += program.evaluate(slots.data());
+        }
+    }, 11);
+    Sample accurate = measure([&]() { evaluate_batch(program, columns.data(), n, out.data()); }, 101);
+    Sample fast = measure([&]() { evaluate_batch(program, columns.data(), n, out.data(), MathMode::FAST); }, 101);
+    Record("fastmath").add("op", "program").add("scalar_ns_per_row", scalar.ns_per_op / n)
+        .add("accurate_ns_per_row", accurate.ns_per_op / n).add("fast_ns_per_row", fast.ns_per_op / n).print();
+}
+
+// Оценка выражения на 1024 рамках: перебор сетки k x k точек через Program::evaluate (нижняя оценка
+// размаха, без гарантии) против интервальной оценки и оценки с проверкой монотонности; ширина
+// интервальных оценок — в долях размаха, найденного перебором
+void bench_interval() {
+    std::unique_ptr<Expression> expr =
+        Expression::create("x ^ 2 * sin(y) + exp(x / 2) * cos(x * y) - ln(y ^ 2 + 1) / (x - 3)");
+    RangeBound range(*expr);
+    Program program = compile(*expr);
+    size_t x = program.slot("x"), y = program.slot("y");
+    for (double size : {0.01, 0.1, 1.0}) {
+        const size_t n = 1024, k = 16;
+        // слоты program и RangeBound совпадают: обе компилируются из одного дерева
+        std::vector<Interval> columns[2] = {std::vector<Interval>(n), std::vector<Interval>(n)};
+        for (size_t i = 0; i < n; ++i) {
+            T cx = -2 + 4.0 * i / n, cy = 2 - 3.0 * ((i * 37) % n) / n;
+            columns[x][i] = Interval(cx, cx + size);
+            columns[y][i] = Interval(cy, cy + size);
+        }
+        const Interval *pointers[2] = {columns[0].data(), columns[1].data()};
+        const std::vector<Interval> &bx = columns[x], &by = columns[y];
+        std::vector<T> sampled(n);
+        Sample sampling = measure([&]() {
+            T slots[2];
+            for (size_t i = 0; i < n; ++i) {
+                T lo = INFINITY, hi = -INFINITY;
+                for (size_t a = 0; a < k; ++a)
+                    for (size_t b = 0; b < k; ++b) {
+                        slots[x] = bx[i].lo + (bx[i].hi - bx[i].lo) * a / (k - 1);
+                        slots[y] = by[i].lo + (by[i].hi - by[i].lo) * b / (k - 1);
+                        T v = program.evaluate(slots);
+                        lo = std::min(lo, v), hi = std::max(hi, v);
+                    }
+                sampled[i] = hi - lo;
+            }
+        }, 5);
+        std::vector<Interval> naive(n), refined(n);
+        Sample interval = measure([&]() { range.bound_batch(pointers, n, naive.data(), false); }, 11);
+        Sample monotone = measure([&]() { range.bound_batch(pointers, n, refined.data()); }, 11);
+        double naive_ratio = 0, refined_ratio = 0;
+        for (size_t i = 0; i < n; ++i) {
+            naive_ratio += double(naive[i].width() / sampled[i]) / n;
+            refined_ratio += double(refined[i].width() / sampled[i]) / n;
+        }
+        Record("interval").add("box", size).add("samples", k * k).add("sampling_ns_per_box", sampling.ns_per_op / n)
+            .add("interval_ns_per_box", interval.ns_per_op / n).add("monotone_ns_per_box", monotone.ns_per_op / n)
+            .add("interval_width_ratio", naive_ratio).add("monotone_width_ratio", refined_ratio).print();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::string filter = (argc > 1 ? argv[1] : "");
+    const std::pair<std::string, void (*)()> benches[] = {
+        {"core", bench_core}, {"compiled", bench_compiled}, {"batch", bench_batch}, {"dag", bench_dag},
+        {"gradient", bench_gradient}, {"taylor", bench_taylor}, {"rewrite", bench_rewrite}, {"arena", bench_arena}, {"parallel", bench_parallel}, {"native", bench_native}, {"static", bench_static}, {"incremental", bench_incremental}, {"serialize", bench_serialize}, {"scalar", bench_scalar}, {"jacobian", bench_jacobian}, {"stress", bench_stress}, {"horner", bench_horner}, {"specialize", bench_specialize}, {"server", bench_server}, {"fastmath", bench_fastmath}, {"interval", bench_interval},
+    };
+    for (auto &[name, bench] : benches)
+        if (name.find(filter) != std::string::npos)
+            bench();
+    return 0;
+}
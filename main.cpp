@@ -1,4 +1,10 @@
 #include "Expression.hpp"
+#include "Taylor.hpp"
+#include "Stream.hpp"
+#include "Native.hpp"
+#include "Serialize.hpp"
+#include "Server.hpp"
+#include "Stats.hpp"
 
 #include <iostream>
 
@@ -15,22 +21,73 @@ std::pair<std::string, T> get_var(std::string source) {
 
 }
 
-int main(int argc, char* argv[]) {
-    if (argc < 3) {
-        std::cerr << "Usage: ./differentiator --eval \"expr\" x=.. y=..\n";
-        std::cerr << "       ./differentiator --diff \"expr\" --by x\n";
-        return 1;
-    }
+int usage() {
+    std::cerr << "Usage: ./differentiator --eval \"expr\" [--native] [--save file] x=.. y=..\n";
+    std::cerr << "       ./differentiator --diff \"expr\" --by x [--minimal] [--save file]\n";
+    std::cerr << "       ./differentiator --diff \"expr\" --by x --order k x=.. y=..\n";
+    std::cerr << "       ./differentiator --load file x=.. y=..\n";
+    std::cerr << "       ./differentiator --batch [file] [--threads n]\n";
+    std::cerr << "       ./differentiator --serve [socket] [--cache n]\n";
+    std::cerr << "       --stats anywhere prints counters and phase timings as JSON to stderr\n";
+    return 1;
+}
+
+// Неотрицательное целое значение опции; false — аргумент не число
+bool get_count(const std::string &source, size_t &value) {
+    if (source.empty() || source.size() > 9 || source.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+    value = std::stoul(source);
+    return true;
+}
+
+int run(int argc, char* argv[]) {
+    if (argc < 3 && !(argc == 2 && (std::string(argv[1]) == "--batch" || std::string(argv[1]) == "--serve")))
+        return usage();
 
     std::string mode = argv[1];
 
-    if (mode == "--eval") {
+    if (mode == "--batch") {
+        std::string path;
+        size_t threads = 1;
+        for (int i = 2; i < argc; ++i) {
+            if (std::string(argv[i]) == "--threads" && i + 1 < argc) {
+                if (!get_count(argv[++i], threads) || threads == 0) {
+                    std::cerr << "Invalid thread count: " << argv[i] << std::endl;
+                    return usage();
+                }
+            } else {
+                path = argv[i];
+            }
+        }
+        return run_batch(path, threads);
+    } else if (mode == "--serve") {
+        std::string path;
+        size_t capacity = 4096;
+        for (int i = 2; i < argc; ++i) {
+            if (std::string(argv[i]) == "--cache" && i + 1 < argc) {
+                if (!get_count(argv[++i], capacity) || capacity == 0) {
+                    std::cerr << "Invalid cache size: " << argv[i] << std::endl;
+                    return usage();
+                }
+            } else {
+                path = argv[i];
+            }
+        }
+        return run_server(path, capacity);
+    } else if (mode == "--eval") {
         std::unique_ptr<Expression> expr = Expression::create(argv[2]);
         std::map<std::string, T> vars;
+        bool native = false;
         for (int i = 3; i < argc; ++i) {
-            vars.insert(get_var(argv[i]));
+            if (std::string(argv[i]) == "--native")
+                native = true;
+            else if (std::string(argv[i]) == "--save" && i + 1 < argc)
+                save(argv[++i], *expr);
+            else
+                vars.insert(get_var(argv[i]));
         }
-        T result = expr->evaluate(vars);
+        STATS(PhaseTimer timer(EVALUATE);)
+        T result = native ? NativeFunction(*expr).evaluate(vars) : expr->evaluate(vars);
         std::cout << result << "\n";
     } else if (mode == "--diff") {
         if (std::string(argv[3]) != "--by") {
@@ -42,14 +99,64 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         std::unique_ptr<Expression> expr = Expression::create(argv[2]);
-        std::unique_ptr<Expression> diff = expr->differentiate(argv[4]);
-        simplify(diff);
-        std::string result = diff->to_string();
-        if (!result.empty() && result[0] == '(' && find_close(result.substr(1)) == result.length() - 2)
-            result = result.substr(1, result.size() - 1);
-        std::cout << result << "\n";
+        int order = 0;
+        Parentheses mode = Parentheses::FULL;
+        std::map<std::string, T> vars;
+        for (int i = 5; i < argc; ++i) {
+            if (std::string(argv[i]) == "--order" && i + 1 < argc) {
+                size_t value;
+                if (!get_count(argv[++i], value) || value > TAYLOR_MAX_ORDER) {
+                    std::cerr << "Invalid order: " << argv[i] << std::endl;
+                    return usage();
+                }
+                order = int(value);
+            }
+            else if (std::string(argv[i]) == "--save" && i + 1 < argc)
+                save(argv[++i], *expr, {argv[4]});
+            else if (std::string(argv[i]) == "--minimal")
+                mode = Parentheses::MINIMAL;
+            else
+                vars.insert(get_var(argv[i]));
+        }
+        // численные производные 1..k за один проход рядами Тейлора
+        if (order > 0) {
+            STATS(PhaseTimer timer(EVALUATE);)
+            std::vector<T> result = derivatives(*expr, argv[4], order, vars);
+            for (int k = 1; k <= order; ++k)
+                std::cout << result[k] << "\n";
+            return 0;
+        }
+        std::cout << derivative_string(*expr, argv[4], mode) << "\n";
+    } else if (mode == "--load") {
+        // значения всех корней файла, по строке на корень: выражение, затем производные
+        ExpressionFile file(argv[2]);
+        std::map<std::string, T> vars;
+        for (int i = 3; i < argc; ++i)
+            vars.insert(get_var(argv[i]));
+        STATS(PhaseTimer timer(EVALUATE);)
+        for (T value : file.evaluate(vars))
+            std::cout << value << "\n";
     } else {
         std::cerr << "Unknown mode: " << mode << std::endl;
         return 1;
     }
-}
\ No newline at end of file
+    return 0;
+}
+
+// --stats убирается из аргументов; счётчики печатаются после выполнения режима, ошибка режима — в stderr
+int main(int argc, char* argv[]) {
+    bool stats = false;
+    int count = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--stats") stats = true;
+        else argv[count++] = argv[i];
+    }
+    int code = 1;
+    try {
+        code = run(count, argv);
+    } catch (const std::exception &error) {
+        std::cerr << error.what() << std::endl;
+    }
+    if (stats) std::cerr << stats_json() << std::endl;
+    return code;
+}
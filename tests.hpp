@@ -1,4 +1,23 @@
 #include "Expression.hpp"
+#include "Bytecode.hpp"
+#include "Batch.hpp"
+#include "Dag.hpp"
+#include "Gradient.hpp"
+#include "Taylor.hpp"
+#include "Arena.hpp"
+#include "Stream.hpp"
+#include "Executor.hpp"
+#include "Rewrite.hpp"
+#include "Native.hpp"
+#include "Static.hpp"
+#include "Incremental.hpp"
+#include "Stats.hpp"
+#include "Serialize.hpp"
+#include "Printer.hpp"
+#include "Jacobian.hpp"
+#include "Polynomial.hpp"
+#include "Server.hpp"
+#include "Interval.hpp"
 
 #include <vector>
 
@@ -20,7 +39,33 @@ std::vector<Test> tests = {
     {"TEST2", "cos(x / 5) - exp(2 ^ x)", 0.5, -3.1182462135, "eval"},
     {"TEST3", "sin(x * cos(x * 2))", 2, 0.61824308331, "diff"},
     {"TEST4", "exp(ln(x^2))", 1, 2, "diff"},
-    {"TEST5", "sin(x) * exp(x)", 0.5, 2.2373281198, "diff"}
+    {"TEST5", "sin(x) * exp(x)", 0.5, 2.2373281198, "diff"},
+    {"TEST6", "-x^2 + 2^-x*3", 2, -3.25, "eval"},
+    {"TEST7", "((x)) * (x + 1) / (x - 3)", 2, -11, "diff"},
+    {"TEST8", "sin(x * 5) + ln(x ^ 2) - x / (x + 1)", 5, 2.25319074144, "compile"},
+    {"TEST9", "cos(x / 5) - exp(2 ^ x) + x * 3", 0.5, -1.6182462135, "batch"},
+    {"TEST10", "sin(x * sin(x * sin(x))) * x ^ 3", 0.7, 0.82726192247, "dag"},
+    {"TEST11", "x * y / (z + x) + exp(y * sin(x)) - ln(z) ^ y + x ^ z", 1.5, 2.56086705, "grad"},
+    {"TEST12", "exp(sin(x)) * ln(x) / x ^ 2 + x ^ 2.5", 1.2, 4.33665228, "taylor"},
+    {"TEST13", "sin(x) * exp(x) / (x + 1) - cos(x_long_variable_name * x)", 0.5, 1.14024582, "arena"},
+    {"TEST14", "sin(x * 5) + ln(x ^ 2)", 5, 3.08652407477, "job"},
+    {"TEST15", "cos(x / 5) - exp(2 ^ x)", 0.5, -3.1182462135, "parallel"},
+    {"TEST16", "2 * x * x + 3 * x ^ 2 - x * x / x + ln(exp(x)) - (0 - x) * 2", 1.5, 17, "rewrite"},
+    {"TEST17", "sin(x) * x * exp(x)", 0.7, 3.28354380799, "rewrite"},
+    {"TEST18", "sin(x) * exp(x / 3) + ln(x + 2) - x ^ 2.5 / (x + 1)", 1.3, -0.0358526608, "native"},
+    {"TEST19", "sin(x * cos(x)) / (x + 1.25) - -x^2 + ln(x) * exp(2 ^ -x)", 0.7, 4.32980958788, "static"},
+    {"TEST20", "sin(x * 5) + ln(y ^ 2) * cos(y) - x / (y + 1) + exp(y / 3)", 0.5, 1.80263750559, "incremental"},
+    {"TEST21", "sin(x) * x * exp(x) / (x + 1)", 0.5, 1.09708229915, "stats"},
+    {"TEST22", "ln(x * y + 3) * sin(x) ^ 2 - exp(y / x) + 2.5", 1.2, 8.81429838029, "serialize"},
+    {"TEST23", "(x + 1) ^ (x - 1) * -2.5 / x - sin(x ^ -2) * 0.1", 1.3, -0.40370243015, "print"},
+    {"TEST24", "exp(sin(x)) * ln(x) / x ^ 2 + x ^ 3", 1.7, 8.57261668452, "scalar"},
+    {"TEST25", "x * y ^ 2 + sin(x * y)", 0.9, 3.54559581061, "jacobian"},
+    {"TEST26", "sin(x) * x", 0.8, 1.27472145838, "stress"},
+    {"TEST27", "3 * x ^ 4 - 2 * x ^ 3 + x ^ 2 / 2 - 7 * x + 1 + sin(x ^ 2 + 1) * (x ^ 3 - x) / (x ^ 2 + 1)", 0.7, -3.85951568958, "horner"},
+    {"TEST28", "a * x ^ 2 + sin(a * b) * x + exp(c / a) * (x - b) * 2 * 3", 0.3, -8.45677759147, "specialize"},
+    {"TEST29", "x * sin(x)", 1, 1.38177329068, "server"},
+    {"TEST30", "sin(x) * cos(x) + exp(x ^ 2 / 4) - ln(x ^ 4 + 1) / x ^ 3", 1.3, 1.16920405844, "fastmath"},
+    {"TEST31", "x ^ 2 * sin(x) + exp(x / 2) - ln(x + 2) / (x - 3)", 1.3, 4.24626149676, "interval"}
     //{"TEST4", "x^y", 1, 2, "diff"},
     //{"TEST5", "y^x", 0.5, 2.2373281198, "diff"}
 };